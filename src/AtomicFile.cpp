@@ -0,0 +1,218 @@
+#include "AtomicFile.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <filesystem>
+#include <set>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool AtomicFile::write(const QString &filePath, const char *data, qint64 size, Durability durability) {
+    if (durability == Durability::Batch) {
+        AtomicWriteBatch batch(durability);
+        return batch.add(filePath, data, size) && batch.commit().isEmpty();
+    }
+
+    QString tempPath = tempPathFor(filePath);
+    if (!writeTemp(tempPath, data, size, durability) || !replace(tempPath, filePath)) {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    if (durability == Durability::EveryFile) {
+        syncDirectory(QFileInfo(filePath).absolutePath());
+    }
+    return true;
+}
+
+bool AtomicFile::write(const QString &filePath, const QByteArray &data, Durability durability) {
+    return write(filePath, data.constData(), data.size(), durability);
+}
+
+int AtomicFile::removeTemporaryFiles(const QString &dirPath) {
+    int removed = 0;
+    const QFileInfoList leftovers = QDir(dirPath).entryInfoList({"*.tmp"}, QDir::Files | QDir::Hidden);
+    for (const QFileInfo &leftover : leftovers) {
+        if (QFile::remove(leftover.absoluteFilePath())) {
+            removed++;
+        } else {
+            qWarning() << "Failed to remove" << leftover.absoluteFilePath();
+        }
+    }
+
+    if (removed > 0) {
+        qDebug() << "Removed" << removed << "temporary files left in" << dirPath;
+    }
+    return removed;
+}
+
+QString AtomicFile::tempPathFor(const QString &filePath) {
+    return filePath + ".tmp";
+}
+
+bool AtomicFile::writeTemp(const QString &tempPath, const char *data, qint64 size, Durability durability) {
+    QFile file(tempPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    if (file.write(data, size) != size || !file.flush()) {
+        return false;
+    }
+
+#ifdef _WIN32
+    if (durability == Durability::EveryFile && _commit(file.handle()) != 0) {
+        return false;
+    }
+#else
+    if (durability == Durability::EveryFile && ::fsync(file.handle()) != 0) {
+        return false;
+    }
+#endif
+#ifdef __linux__
+    // Queue the pages for writeback without waiting, so the fsync in commit() finds little left to do
+    if (durability == Durability::Batch) {
+        ::sync_file_range(file.handle(), 0, 0, SYNC_FILE_RANGE_WRITE);
+    }
+#endif
+    return true;
+}
+
+bool AtomicFile::replace(const QString &tempPath, const QString &filePath) {
+    // Unlike QFile::rename this overwrites an existing target, atomically on POSIX and through
+    // MoveFileEx on Windows
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(tempPath.toStdU16String()),
+                            std::filesystem::path(filePath.toStdU16String()), error);
+    if (error) {
+        qWarning() << "Failed to rename" << tempPath << "to" << filePath << ":" << QString::fromStdString(error.message());
+        return false;
+    }
+    return true;
+}
+
+bool AtomicFile::syncFile(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool AtomicFile::syncFiles(const std::vector<QString> &filePaths) {
+    bool synced = true;
+#ifdef __linux__
+    // Every file's pages are written back and waited for, then one fdatasync on the last file commits
+    // the journal and flushes the disk cache for all of them. syncfs would also wait for whatever
+    // else is being written to the same filesystem.
+    for (size_t i = 0; i < filePaths.size(); i++) {
+        QFile file(filePaths[i]);
+        bool last = i + 1 == filePaths.size();
+        if (!file.open(QIODevice::ReadWrite) ||
+            ::sync_file_range(file.handle(), 0, 0,
+                              SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0 ||
+            (last && ::fdatasync(file.handle()) != 0)) {
+            qWarning() << "Failed to sync" << filePaths[i];
+            synced = false;
+        }
+    }
+#else
+    // Windows has no flush covering several files, each one is committed with _commit in syncFile.
+    // Other systems fsync each file as well.
+    for (const QString &filePath : filePaths) {
+        if (!syncFile(filePath)) {
+            qWarning() << "Failed to sync" << filePath;
+            synced = false;
+        }
+    }
+#endif
+    return synced;
+}
+
+void AtomicFile::syncDirectory(const QString &dirPath) {
+#ifndef _WIN32
+    // Makes the renames themselves durable, Windows has no equivalent for directories
+    int fd = ::open(QFile::encodeName(dirPath).constData(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)dirPath;
+#endif
+}
+
+AtomicWriteBatch::AtomicWriteBatch(AtomicFile::Durability durability)
+    : durability(durability) {
+}
+
+AtomicWriteBatch::~AtomicWriteBatch() {
+    for (const auto &[tempPath, filePath] : pending) {
+        QFile::remove(tempPath);
+    }
+}
+
+bool AtomicWriteBatch::add(const QString &filePath, const char *data, qint64 size) {
+    if (!defersRename()) {
+        return AtomicFile::write(filePath, data, size, durability);
+    }
+
+    QString tempPath = AtomicFile::tempPathFor(filePath);
+    if (!AtomicFile::writeTemp(tempPath, data, size, durability)) {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.emplace_back(tempPath, filePath);
+    return true;
+}
+
+QStringList AtomicWriteBatch::pendingFiles() {
+    std::lock_guard<std::mutex> lock(mutex);
+    QStringList files;
+    for (const auto &entry : pending) {
+        files.append(entry.second);
+    }
+    return files;
+}
+
+QStringList AtomicWriteBatch::commit() {
+    std::lock_guard<std::mutex> lock(mutex);
+    QStringList failed;
+    if (pending.empty()) {
+        return failed;
+    }
+
+    std::vector<QString> tempPaths;
+    for (const auto &entry : pending) {
+        tempPaths.push_back(entry.first);
+    }
+    AtomicFile::syncFiles(tempPaths);
+
+    std::set<QString> directories;
+    for (const auto &[tempPath, filePath] : pending) {
+        if (AtomicFile::replace(tempPath, filePath)) {
+            directories.insert(QFileInfo(filePath).absolutePath());
+        } else {
+            QFile::remove(tempPath);
+            failed.append(filePath);
+        }
+    }
+    pending.clear();
+
+    for (const auto &directory : directories) {
+        AtomicFile::syncDirectory(directory);
+    }
+    return failed;
+}
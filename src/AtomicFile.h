@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * Crash-safe file output: data goes to "<name>.tmp" next to the target and is renamed
+ * over it, so a reader only ever sees the old file or the complete new one.
+ */
+class AtomicFile
+{
+public:
+    enum class Durability {
+        None,     // Rename only, safe against the application crashing but not against power loss
+        Batch,    // Writeback starts as each file of an AtomicWriteBatch is added, commit() waits for it and
+                  // flushes once. A single write() is a batch of one.
+        EveryFile // The file is synced before its rename and the directory after it
+    };
+
+    static bool write(const QString &filePath, const char *data, qint64 size, Durability durability);
+    static bool write(const QString &filePath, const QByteArray &data, Durability durability);
+
+    // Deletes the temporary files a crash left behind in dirPath, returns how many. Only call it
+    // while nothing writes to the directory, e.g. when a project is opened.
+    static int removeTemporaryFiles(const QString &dirPath);
+
+private:
+    friend class AtomicWriteBatch;
+
+    static QString tempPathFor(const QString &filePath);
+    // EveryFile syncs the file before returning, Batch only starts its writeback
+    static bool writeTemp(const QString &tempPath, const char *data, qint64 size, Durability durability);
+    static bool replace(const QString &tempPath, const QString &filePath);
+    static bool syncFile(const QString &filePath);
+    // Makes the contents of all the files durable, with a single flush where the system allows it
+    static bool syncFiles(const std::vector<QString> &filePaths);
+    static void syncDirectory(const QString &dirPath);
+};
+
+/**
+ * Files written together, e.g. the photos of one sheet. With Durability::Batch the files stay
+ * temporary until commit(), which syncs them together, renames them all and then syncs each of
+ * their directories once. The kernel already writes them back while the rest of the batch is encoded.
+ * Other durability levels put each file in place from add(). Thread safe.
+ */
+class AtomicWriteBatch
+{
+public:
+    explicit AtomicWriteBatch(AtomicFile::Durability durability);
+    ~AtomicWriteBatch(); // Removes temporary files that were never committed
+
+    AtomicWriteBatch(const AtomicWriteBatch &) = delete;
+    AtomicWriteBatch &operator=(const AtomicWriteBatch &) = delete;
+
+    bool add(const QString &filePath, const char *data, qint64 size);
+    // Returns the files that could not be put in place
+    QStringList commit();
+
+    // True when files only reach their final name in commit()
+    bool defersRename() const { return durability == AtomicFile::Durability::Batch; }
+    QStringList pendingFiles();
+
+private:
+    const AtomicFile::Durability durability;
+    std::mutex mutex;
+    std::vector<std::pair<QString, QString>> pending; // Temporary path, final path
+};
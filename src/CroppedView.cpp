@@ -74,6 +74,11 @@ void CroppedViewItem::manualResize(int viewHeight) {
     }
 }
 
+void CroppedViewItem::setPixmap(const QPixmap &pixmap) {
+    originalPixmap = pixmap;
+    imageLabel->setPixmap(pixmap);
+}
+
 void CroppedViewItem::enterEvent(QEnterEvent *event) {
     rotateLeftButton->setVisible(true);
     rotateRightButton->setVisible(true);
@@ -123,25 +128,51 @@ void CroppedView::resizeEvent(QResizeEvent *event) {
     manualResize();
 }
 
+void CroppedView::setImageItem(int index, const QPixmap &pixmap) {
+    QListWidgetItem *item = this->item(index);
+    if (!item) {
+        return;
+    }
+
+    // Swap the pixmap in place, the other rows and their widgets stay untouched
+    if (auto croppedViewItem = qobject_cast<CroppedViewItem *>(itemWidget(item))) {
+        croppedViewItem->setPixmap(pixmap);
+        resizeItem(index);
+    }
+}
+
+void CroppedView::setItemCount(int count) {
+    while (this->count() > count) {
+        delete takeItem(this->count() - 1);
+    }
+    while (this->count() < count) {
+        addImageItem(QPixmap(), this->count());
+    }
+}
+
 void CroppedView::manualResize() {
+    for (int i = 0; i < count(); ++i) {
+        resizeItem(i);
+    }
+}
+
+void CroppedView::resizeItem(int index) {
 
     int dynamicHeight = height() * 0.9; // Example: Divide the height into 2 rows
 
-    for (int i = 0; i < count(); ++i) {
-        QListWidgetItem *item = this->item(i);
-        if (item) {
-            // item->setSizeHint(QSize(dynamicWidth, dynamicHeight));
-
-            QWidget *widget = this->itemWidget(item);
-            if (auto croppedViewItem = qobject_cast<CroppedViewItem *>(widget)) {
-                int newWidth = 0;
-                croppedViewItem->manualResize(dynamicHeight); // Adjust child widget sizes
-                newWidth = croppedViewItem->width();
-
-                if (newWidth != 0) {
-                    qDebug() << "New Width:" << newWidth;
-                    item->setSizeHint(QSize(newWidth*1, height() * 0.9));
-                }
+    QListWidgetItem *item = this->item(index);
+    if (item) {
+        // item->setSizeHint(QSize(dynamicWidth, dynamicHeight));
+
+        QWidget *widget = this->itemWidget(item);
+        if (auto croppedViewItem = qobject_cast<CroppedViewItem *>(widget)) {
+            int newWidth = 0;
+            croppedViewItem->manualResize(dynamicHeight); // Adjust child widget sizes
+            newWidth = croppedViewItem->width();
+
+            if (newWidth != 0) {
+                qDebug() << "New Width:" << newWidth;
+                item->setSizeHint(QSize(newWidth*1, height() * 0.9));
             }
         }
     }
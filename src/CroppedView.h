@@ -16,6 +16,7 @@ class CroppedViewItem : public QWidget {
 public:
     explicit CroppedViewItem(const QPixmap &pixmap, QWidget *parent = nullptr);
     void manualResize(int viewHeight);
+    void setPixmap(const QPixmap &pixmap);
 
 protected:
     void enterEvent(QEnterEvent *event) override;
@@ -39,6 +40,8 @@ class CroppedView : public QListWidget {
 public:
     explicit CroppedView(QWidget *parent = nullptr);
     void addImageItem(const QPixmap &pixmap, int index);
+    void setImageItem(int index, const QPixmap &pixmap);
+    void setItemCount(int count);
     void manualResize();
 
 signals:
@@ -51,6 +54,7 @@ private:
     int itemWidth;
     int itemHeight;
     void updateItemSizes();
+    void resizeItem(int index);
 };
 
 #endif // CUSTOMLISTVIEW_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "ImageEditorView.h"
 // #include "QuadrilateralItem.h"
 
+#include <QGraphicsPixmapItem>
 #include <QVBoxLayout>
 
 ImageEditorView::ImageEditorView(QWidget *parent = nullptr)
@@ -34,6 +35,11 @@ ImageEditorView::ImageEditorView(QWidget *parent = nullptr)
     connect(rotateLeftButton, &QPushButton::clicked, this, &ImageEditorView::rotateSceneLeft);
     connect(rotateRightButton, &QPushButton::clicked, this, &ImageEditorView::rotateSceneRight);
     connect(addQuadrilateralButton, &QPushButton::clicked, this, &ImageEditorView::addEmptyQuadrilateral);
+
+    // Corner drags mark quads dirty on every mouse move, the timer batches them into one emit per frame
+    changeTimer.setSingleShot(true);
+    changeTimer.setInterval(frameIntervalMs);
+    connect(&changeTimer, &QTimer::timeout, this, &ImageEditorView::emitQuadChanges);
 }
 
 void ImageEditorView::wheelEvent(QWheelEvent *event) {
@@ -96,11 +102,7 @@ void ImageEditorView::addEmptyQuadrilateral() {
         cv::Point(center.x - width / 6, center.y + width / 8)};
 
     auto *quad = new QuadrilateralItem(points, this->scene(), this->scene());
-
-    connect(quad, &QuadrilateralItem::positionChanged, this, &ImageEditorView::updateQuads);
-    connect(quad, &QuadrilateralItem::deletePressed, this, &ImageEditorView::deleteQuad);
-
-    updateQuads();
+    registerQuad(quad, true);
 }
 
 
@@ -108,14 +110,40 @@ void ImageEditorView::addEmptyQuadrilateral() {
 void ImageEditorView::addQuadrilateral(std::vector<cv::Point> points) {
 
     auto *quad = new QuadrilateralItem(points, this->scene(), this->scene());
+    registerQuad(quad, false);
+}
+
+void ImageEditorView::registerQuad(QuadrilateralItem *quad, bool markChanged) {
+    int id = nextQuadId++;
+    quadItems[id] = quad;
 
-    connect(quad, &QuadrilateralItem::positionChanged, this, &ImageEditorView::updateQuads);
+    connect(quad, &QuadrilateralItem::positionChanged, this, [this, id]() { markDirty(id); });
     connect(quad, &QuadrilateralItem::deletePressed, this, &ImageEditorView::deleteQuad);
+    // Covers deleteQuad as well as scene()->clear() when a new scan is displayed
+    connect(quad, &QObject::destroyed, this, [this, id]() {
+        quadItems.erase(id);
+        markDirty(id);
+    });
+
+    if (markChanged) {
+        markDirty(id);
+    }
+}
+
+void ImageEditorView::markDirty(int id) {
+    dirtyQuads.insert(id);
+    if (!changeTimer.isActive()) {
+        changeTimer.start();
+    }
+}
+
+void ImageEditorView::discardQuadChanges() {
+    changeTimer.stop();
+    dirtyQuads.clear();
 }
 
 void ImageEditorView::deleteQuad(QuadrilateralItem *q) {
     delete q;
-    updateQuads();
 }
 
 void ImageEditorView::resizeEvent(QResizeEvent *event) {
@@ -129,17 +157,65 @@ void ImageEditorView::positionButtons() {
 }
 
 void ImageEditorView::updateQuads() {
-    // Update all quadrilaterals
+    changeTimer.stop();
+    emitQuadChanges();
+}
+
+void ImageEditorView::emitQuadChanges() {
+    std::vector<int> changedIds(dirtyQuads.begin(), dirtyQuads.end());
+    dirtyQuads.clear();
+
     std::vector<std::vector<cv::Point>> quads;
     getQuads(quads);
 
-    emit quadrilateralsChanged(quads);
+    emit quadrilateralsChanged(quads, changedIds);
 }
 
 void ImageEditorView::getQuads(std::vector<std::vector<cv::Point>> &quads) {
-    for (auto item : scene()->items()) {
-        if (auto *quad = qgraphicsitem_cast<QuadrilateralItem *>(item)) {
-            quads.push_back(quad->getCorners());
-        }
+    for (const auto &[id, quad] : quadItems) {
+        quads.push_back(quad->getCorners());
+    }
+}
+
+std::vector<int> ImageEditorView::quadIds() const {
+    std::vector<int> ids;
+    for (const auto &entry : quadItems) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+void ImageEditorView::beginProgressiveScan(int width, int expectedRows) {
+    if (!scene()) {
+        return;
+    }
+    scene()->clear();
+
+    // Unknown heights start as a letter size sheet
+    progressiveRect = QRectF(0, 0, width, expectedRows > 0 ? expectedRows : width * 11 / 8.5);
+    scene()->setSceneRect(progressiveRect);
+    fitInView(progressiveRect, Qt::KeepAspectRatio);
+    positionButtons();
+}
+
+void ImageEditorView::setEditingEnabled(bool enabled) {
+    buttonOverlay->setEnabled(enabled);
+    // Mouse and key events no longer reach the quads
+    setInteractive(enabled);
+}
+
+void ImageEditorView::addScanBand(const QImage &band, int firstRow) {
+    if (!scene() || band.isNull()) {
+        return;
+    }
+
+    // One item per band, so a band is converted once and earlier bands are not repainted
+    QGraphicsPixmapItem *item = scene()->addPixmap(QPixmap::fromImage(band));
+    item->setPos(0, firstRow);
+
+    if (firstRow + band.height() > progressiveRect.height()) {
+        progressiveRect.setHeight(firstRow + band.height());
+        scene()->setSceneRect(progressiveRect);
+        fitInView(progressiveRect, Qt::KeepAspectRatio);
     }
 }
@@ -2,12 +2,16 @@
 #define IMAGE_EDITOR_VIEW_H
 
 #include <QGraphicsView>
+#include <QImage>
 #include <QMouseEvent> // for QMouseEvent
 #include <QPushButton>
+#include <QTimer>
 #include <QWheelEvent>
 #include <QWidget> // for QWidget if needed
 #include <opencv2/core.hpp>
 #include "QuadrilateralItem.h"
+#include <map>
+#include <set>
 
 class ImageEditorView : public QGraphicsView {
     Q_OBJECT
@@ -15,11 +19,25 @@ class ImageEditorView : public QGraphicsView {
 public:
     explicit ImageEditorView(QWidget *parent);
     void positionButtons();
+    // Quads added here are not reported as changed, the caller already knows about them
     void addQuadrilateral(std::vector<cv::Point> points);
     void addEmptyQuadrilateral();
     void deleteQuad(QuadrilateralItem *q);
+    // Emits quadrilateralsChanged right away instead of waiting for the next frame
     void updateQuads();
+    // Quads in the order they were added, quadIds() lists their ids in the same order
     void getQuads(std::vector<std::vector<cv::Point>> &quads);
+    std::vector<int> quadIds() const;
+    // Forgets the changes not emitted yet, e.g. the quads removed with the previous scan
+    void discardQuadChanges();
+
+    // Shows a scan while it is transferred: the scene is cleared and each band is added below the
+    // previous ones. expectedRows is -1 when unknown, the view then grows with the bands.
+    // The finished scan replaces the bands (see MainWindow::displayMatInGraphicsView).
+    void beginProgressiveScan(int width, int expectedRows);
+    void addScanBand(const QImage &band, int firstRow);
+    // While disabled quads can not be added, moved or deleted and the scan not rotated, zooming still works
+    void setEditingEnabled(bool enabled);
 
 protected:
     void wheelEvent(QWheelEvent *event) override;
@@ -28,18 +46,33 @@ protected:
     void resizeEvent(QResizeEvent *event) override;
 
 signals:
-    void quadrilateralsChanged(std::vector<std::vector<cv::Point>> quads);
+    // At most once per frame. changedIds holds the quads added, moved or removed since the last emit,
+    // it is empty when only an orientation changed and the caller forced an update.
+    void quadrilateralsChanged(std::vector<std::vector<cv::Point>> quads, std::vector<int> changedIds);
     void scanRotated(int angle);
 
 private slots:
     void rotateSceneLeft();
     void rotateSceneRight();
+    void emitQuadChanges();
 
 private:
     QWidget *buttonOverlay;
     QPushButton *rotateLeftButton;
     QPushButton *rotateRightButton;
     QPushButton *addQuadrilateralButton;
+
+    // Registry of the quads in the scene, so changes never need a walk over scene()->items()
+    std::map<int, QuadrilateralItem *> quadItems;
+    std::set<int> dirtyQuads;
+    int nextQuadId = 0;
+    QTimer changeTimer;
+    QRectF progressiveRect; // Scene area reserved for the scan in progress
+
+    static constexpr int frameIntervalMs = 16;
+
+    void registerQuad(QuadrilateralItem *quad, bool markChanged);
+    void markDirty(int id);
 };
 
 #endif // IMAGE_EDITOR_VIEW_H
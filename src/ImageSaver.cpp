@@ -1,6 +1,9 @@
 #include "ImageSaver.h"
 #include <QDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
 #include <exiv2/exiv2.hpp>
 
 bool ImageSaver::saveImage(const cv::Mat &image, const QString &filePath, const QString &dateTimeString, std::pair<double, double> imageLocation) {
@@ -9,20 +12,46 @@ bool ImageSaver::saveImage(const cv::Mat &image, const QString &filePath, const
         return false;
     }
 
-    // Save the image file
-    bool res = cv::imwrite(filePath.toStdString(), image);
-    if (!res) {
+    std::vector<uchar> jpeg;
+    if (!encodeJpeg(image, dateTimeString, imageLocation, jpeg)) {
+        qWarning() << "Failed to encode image for" << filePath;
+        return false;
+    }
+
+    if (!writeFile(filePath, jpeg)) {
         qWarning() << "Failed to save image to" << filePath;
         return false;
-    } else {
-        qDebug() << "Image saved to" << filePath;
+    }
+
+    qDebug() << "Image saved to" << filePath;
+    return true;
+}
+
+// Serializes the image with its updated metadata from Exiv2's in-memory IO
+static bool writeMetadataToBuffer(Exiv2::Image &exiv_image, std::vector<uchar> &buffer) {
+    exiv_image.writeMetadata();
+
+    Exiv2::BasicIo &io = exiv_image.io();
+    if (io.open() != 0) {
+        return false;
+    }
+    Exiv2::DataBuf data = io.read(static_cast<long>(io.size()));
+    buffer.assign(data.pData_, data.pData_ + data.size_);
+    return !buffer.empty();
+}
+
+bool ImageSaver::encodeJpeg(const cv::Mat &image, const QString &dateTimeString, std::pair<double, double> imageLocation, std::vector<uchar> &jpeg, int exifOrientation) {
+    // Same default quality as cv::imwrite
+    std::vector<uchar> encoded;
+    if (image.empty() || !cv::imencode(".jpg", image, encoded)) {
+        return false;
     }
 
     try {
-        // Load the image file using Exiv2
-        Exiv2::Image::AutoPtr exiv_image = Exiv2::ImageFactory::open(filePath.toStdString());
+        // Exiv2 works on its own MemIo copy of the buffer
+        Exiv2::Image::AutoPtr exiv_image = Exiv2::ImageFactory::open(encoded.data(), static_cast<long>(encoded.size()));
         if (!exiv_image.get()) {
-            throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to open image file.");
+            throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to open encoded image.");
         }
 
         // Read the existing metadata
@@ -44,17 +73,148 @@ bool ImageSaver::saveImage(const cv::Mat &image, const QString &filePath, const
         exifData["Exif.GPSInfo.GPSLongitude"] = toExifString(longitude, true, false);
         exifData["Exif.GPSInfo.GPSLongitudeRef"] = longitude >= 0 ? "E" : "W";
 
-        // Save the updated metadata back to the file
-        exiv_image->writeMetadata();
+        // Set when the pixels are stored unrotated, see SaveQueue::OrientationMode
+        if (exifOrientation != 1) {
+            exifData["Exif.Image.Orientation"] = static_cast<uint16_t>(exifOrientation);
+        }
 
-        std::cout << "Metadata updated successfully." << std::endl;
+        // Rewrites the JPEG in memory with the APP1 segment inserted
+        if (!writeMetadataToBuffer(*exiv_image, jpeg)) {
+            throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to read back encoded image.");
+        }
     } catch (Exiv2::Error &e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return false;
     }
 
-    return res;
+    return !jpeg.empty();
 }
+
+bool ImageSaver::writeFile(const QString &filePath, const std::vector<uchar> &data, AtomicFile::Durability durability) {
+    return AtomicFile::write(filePath, reinterpret_cast<const char *>(data.data()), static_cast<qint64>(data.size()), durability);
+}
+
+// Turns the DCT blocks with jpegtran, nothing is decoded. -perfect makes it fail rather than leave the
+// partial blocks at the right and bottom edges unturned. False when jpegtran is not installed.
+static bool rotateLosslessly(const QByteArray &jpeg, int clockwiseDegrees, QByteArray &rotated) {
+    static const QString jpegtran = QStandardPaths::findExecutable("jpegtran");
+    if (jpegtran.isEmpty()) {
+        return false;
+    }
+
+    QProcess process;
+    process.start(jpegtran, {"-copy", "all", "-perfect", "-rotate", QString::number(clockwiseDegrees)});
+    if (!process.waitForStarted()) {
+        return false;
+    }
+    process.write(jpeg);
+    process.closeWriteChannel();
+    if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qDebug() << "jpegtran could not turn the image losslessly:" << process.readAllStandardError();
+        return false;
+    }
+
+    rotated = process.readAllStandardOutput();
+    return !rotated.isEmpty();
+}
+
+bool ImageSaver::reorient(const QString &filePath, int clockwiseDegrees, AtomicFile::Durability durability) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open" << filePath;
+        return false;
+    }
+    QByteArray original = file.readAll();
+    file.close();
+
+    std::vector<uchar> jpeg;
+    try {
+        QByteArray rotated; // Outlives exiv_image, which reads from it
+        Exiv2::Image::AutoPtr exiv_image = Exiv2::ImageFactory::open(reinterpret_cast<const Exiv2::byte *>(original.constData()), static_cast<long>(original.size()));
+        if (!exiv_image.get()) {
+            throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to open image file.");
+        }
+        exiv_image->readMetadata();
+        Exiv2::ExifData &exifData = exiv_image->exifData();
+
+        int current = 1;
+        auto orientationTag = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+        if (orientationTag != exifData.end()) {
+            current = static_cast<int>(orientationTag->toLong());
+        }
+
+        int currentDegrees = clockwiseDegreesFor(current);
+        if (currentDegrees < 0) {
+            qWarning() << filePath << "has a mirrored orientation, not changing it";
+            return false;
+        }
+
+        int degrees = (((currentDegrees + clockwiseDegrees) % 360) + 360) % 360;
+        int orientation = exifOrientationFor(degrees);
+        if (orientation == 0) {
+            qWarning() << "Only right angles can be applied losslessly, got" << clockwiseDegrees;
+            return false;
+        }
+
+        // The pixels are turned when jpegtran can do it without loss, the tag alone is the fallback
+        if (degrees != 0 && rotateLosslessly(original, degrees, rotated)) {
+            exiv_image = Exiv2::ImageFactory::open(reinterpret_cast<const Exiv2::byte *>(rotated.constData()), static_cast<long>(rotated.size()));
+            if (!exiv_image.get()) {
+                throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to open the rotated image.");
+            }
+            exiv_image->readMetadata();
+            orientation = 1;
+        } else if (orientation == current) {
+            return true;
+        }
+
+        // jpegtran copies the old tag along with the rest of the Exif data
+        exiv_image->exifData()["Exif.Image.Orientation"] = static_cast<uint16_t>(orientation);
+        if (!writeMetadataToBuffer(*exiv_image, jpeg)) {
+            throw Exiv2::Error(Exiv2::kerErrorMessage, "Failed to write metadata.");
+        }
+    } catch (Exiv2::Error &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    return AtomicFile::write(filePath, reinterpret_cast<const char *>(jpeg.data()), static_cast<qint64>(jpeg.size()), durability);
+}
+
+int ImageSaver::exifOrientationFor(int clockwiseDegrees) {
+    switch (((clockwiseDegrees % 360) + 360) % 360) {
+    case 0:
+        return 1;
+    case 90:
+        return 6;
+    case 180:
+        return 3;
+    case 270:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+int ImageSaver::clockwiseDegreesFor(int exifOrientation) {
+    switch (exifOrientation) {
+    case 3:
+        return 180;
+    case 6:
+        return 90;
+    case 8:
+        return 270;
+    case 2:
+    case 4:
+    case 5:
+    case 7:
+        return -1;
+    default:
+        // 1, and out of range values which readers treat as 1
+        return 0;
+    }
+}
+
 std::string ImageSaver::toExifString(double d, bool bRational, bool bLat) {
     const char *NS = d >= 0.0 ? "N" : "S";
     const char *EW = d >= 0.0 ? "E" : "W";
@@ -1,12 +1,30 @@
 #pragma once
+#include "AtomicFile.h"
 #include <opencv2/opencv.hpp>
 #include <QString>
 
 class ImageSaver
 {
 public:
+    // Encodes to memory with encodeJpeg and writes the file once
     bool saveImage(const cv::Mat& image, const QString& filePath, const QString& dateTimeString, std::pair<double, double> imageLocation);
 
+    // Compresses the image and embeds DateTimeOriginal, GPS and Orientation EXIF tags, without touching the disk
+    static bool encodeJpeg(const cv::Mat& image, const QString& dateTimeString, std::pair<double, double> imageLocation, std::vector<uchar>& jpeg, int exifOrientation = 1);
+    // Goes through a temporary file, see AtomicFile
+    static bool writeFile(const QString& filePath, const std::vector<uchar>& data, AtomicFile::Durability durability = AtomicFile::Durability::EveryFile);
+
+    // Turns a saved photo by a multiple of 90 degrees clockwise without decoding it, together with any turn
+    // its Exif.Image.Orientation tag still asks for. With jpegtran on the PATH the DCT blocks themselves
+    // are turned and the tag is reset; without it, or when the size is not a whole number of blocks,
+    // only the tag is rewritten.
+    static bool reorient(const QString& filePath, int clockwiseDegrees, AtomicFile::Durability durability = AtomicFile::Durability::EveryFile);
+
+    // Orientation tag that makes viewers turn the stored pixels clockwiseDegrees, 0 when that is not a right angle
+    static int exifOrientationFor(int clockwiseDegrees);
+    // Inverse of exifOrientationFor, -1 for the mirrored orientations
+    static int clockwiseDegreesFor(int exifOrientation);
+
     static std::string toExifString(double d, bool bRational, bool bLat);
     // Potentially add methods to embed metadata
     // bool embedMetadata(const QString& filePath, ...);
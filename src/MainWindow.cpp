@@ -5,15 +5,28 @@
 #include "ImageEditorView.h"
 #include "Project.h"
 #include "QuadrilateralItem.h"
+#include "RegionScan.h"
 #include "ScanProcessor.h"
+#include "ScanPyramid.h"
 #include "ScannerInterface.h"
 
-#include "ImageSaver.h"
+#include "SaveQueue.h"
+#include "ScanSession.h"
+#include "ScanTileItem.h"
+#include "ScannerDiscovery.h"
+#include "ScannerWorker.h"
+#include "StreamingDetector.h"
+#include <QActionGroup>
 #include <QDebug>
 #include <QFileDialog>
 #include <QGraphicsRectItem>
 #include <QListWidget>
 #include <QMessageBox>
+#include <QPointer>
+#include <QSignalBlocker>
+#include <QStandardItemModel>
+#include <QThread>
+#include <QtConcurrent>
 #include <QtQml>
 
 #include "C:\Qt\6.8.1\mingw_64\include\QtQml\qqmlcontext.h"
@@ -27,9 +40,69 @@ MainWindow::MainWindow(std::string path, QWidget *parent)
 
     projectPath = path;
     projectData = Project::loadProject(projectPath);
-    scanner = nullptr;
+
+    // A single preview worker: a new job waits for the superseded one, which stops at its next crop
+    previewPool.setMaxThreadCount(1);
+    previewGeneration = std::make_shared<std::atomic<quint64>>(0);
+
+    // Detect on a 1/4 proxy and refine the edges at full resolution. The quads are drawn as
+    // QuadrilateralItems, so no annotated copy of the scan or eager crops are needed.
+    processorOptions.resultMode = ScanProcessor::ResultMode::Lazy;
+    processorOptions.detectionMode = ScanProcessor::DetectionMode::Pyramid;
+    processorOptions.pyramidLevels = 2;
+    processorOptions.maxCropThreads = QThread::idealThreadCount();
 
     ui->setupUi(this);
+    scanButtonText = ui->btnScan->text();
+
+    // Every scanner call runs on this worker, the window only waits for its results
+    scannerWorker = new ScannerWorker(this);
+
+    // Saving runs in the background so the next sheet can be scanned right away
+    saveQueue = new SaveQueue(processorOptions, 0, 4, this);
+    connect(saveQueue, &SaveQueue::progress, this, [this](int completed, int total) {
+        statusBar()->showMessage(QString("Saving photos: %1 of %2").arg(completed).arg(total));
+    });
+    connect(saveQueue, &SaveQueue::saveFailed, this, [this](const QString &filePath) {
+        statusBar()->showMessage("Failed to save " + filePath);
+    });
+    connect(ui->actionScanSession, &QAction::toggled, this, &MainWindow::onScanSessionToggled);
+
+    // The durability is a project setting, it applies to the photos and to project.json
+    const std::pair<QAction *, AtomicFile::Durability> durabilityActions[] = {
+        {ui->actionSaveNoSync, AtomicFile::Durability::None},
+        {ui->actionSaveSyncPerSheet, AtomicFile::Durability::Batch},
+        {ui->actionSaveSyncEveryFile, AtomicFile::Durability::EveryFile}};
+    auto *durabilityGroup = new QActionGroup(this);
+    for (const auto &[action, durability] : durabilityActions) {
+        durabilityGroup->addAction(action);
+        action->setChecked(durability == projectData.saveDurability);
+        connect(action, &QAction::triggered, this, [this, durability]() {
+            projectData.saveDurability = durability;
+            saveQueue->setDurability(durability);
+            saveProjectData();
+        });
+    }
+    saveQueue->setDurability(projectData.saveDurability);
+
+    auto orientationModeFor = [](bool inExif) {
+        return inExif ? SaveQueue::OrientationMode::ExifTag : SaveQueue::OrientationMode::Pixels;
+    };
+    ui->actionOrientationInExif->setChecked(projectData.orientationInExif);
+    saveQueue->setOrientationMode(orientationModeFor(projectData.orientationInExif));
+    connect(ui->actionOrientationInExif, &QAction::triggered, this, [this, orientationModeFor](bool checked) {
+        projectData.orientationInExif = checked;
+        saveQueue->setOrientationMode(orientationModeFor(checked));
+        saveProjectData();
+    });
+
+    connect(saveQueue, &SaveQueue::finished, this, [this](int saved, int failed) {
+        if (failed > 0) {
+            QMessageBox::warning(this, "Error", QString("Failed to save %1 of %2 photos.").arg(failed).arg(saved + failed));
+        } else {
+            statusBar()->showMessage(QString("Saved %1 photos.").arg(saved), 5000);
+        }
+    });
 
     ui->labelProject->setText(QString::fromStdString(projectData.projectName));
     ui->projectCount->display(projectData.imagesCount);
@@ -60,15 +133,33 @@ MainWindow::MainWindow(std::string path, QWidget *parent)
 
     
 
-    onFindScannerButtonClicked();
+    // The scanners found last time are offered right away, the drivers are asked in the background
+    fillScannerList(capabilityCache.devices());
 
     // select the scanner from the combo box from projectData.scannerName
     int index = ui->comboScanners->findText(QString::fromStdString(projectData.scannerName));
-    if (index != -1) {
-        ui->comboScanners->setCurrentIndex(index);
-    } else {
-        ui->comboScanners->setCurrentIndex(0);
+    {
+        // The slot is not connected yet, the selection is opened below whether or not the text changed
+        QSignalBlocker blocker(ui->comboScanners);
+        ui->comboScanners->setCurrentIndex(std::max(index, 0));
     }
+    onScannerSelectionChanged(ui->comboScanners->currentText());
+
+    scannerDiscovery = new ScannerDiscovery(this);
+    connect(scannerDiscovery, &ScannerDiscovery::scannersFound, this, [this](const QStringList &scanners) {
+        ui->btnFindScanners->setEnabled(true);
+        capabilityCache.setDevices(scanners);
+        fillScannerList(scanners);
+        if (scanners.empty()) {
+            statusBar()->showMessage("No scanners found.", 5000);
+        } else {
+            statusBar()->showMessage(QString("Found %1 scanners.").arg(scanners.size()), 5000);
+        }
+    });
+    connect(scannerDiscovery, &ScannerDiscovery::discoveryFailed, this, [this](const QString &message) {
+        ui->btnFindScanners->setEnabled(true);
+        statusBar()->showMessage("Scanner discovery failed: " + message, 5000);
+    });
 
     // set the time
     QDateTime dateTime = QDateTime::fromString(QString::fromStdString(projectData.imageDateTime), Qt::ISODate);
@@ -109,6 +200,8 @@ MainWindow::MainWindow(std::string path, QWidget *parent)
     connect(ui->comboColor, SIGNAL(currentIndexChanged(int)), this, SLOT(onColorOptionChanged(int)));
     connect(ui->comboDPI, SIGNAL(currentIndexChanged(int)), this, SLOT(onDpiOptionChanged(int)));
 
+    onFindScannerButtonClicked();
+
     croppedView = new CroppedView(this);
     // croppedView->setGeometry(ui->listThumbnails->geometry());
     croppedView->setObjectName(ui->listThumbnails->objectName());
@@ -191,6 +284,17 @@ MainWindow::MainWindow(std::string path, QWidget *parent)
 }
 
 MainWindow::~MainWindow() {
+    // Cancel any preview job and wait for it, jobs post their results back to this window
+    ++*previewGeneration;
+    previewPool.waitForDone();
+    // Stop scanning, then finish writing the photos whose names were already reserved
+    scanCancel.cancel();
+    delete scannerWorker;
+    scannerWorker = nullptr;
+    delete scanSession;
+    scanSession = nullptr;
+    saveQueue->waitForDone();
+
     delete ui;
 }
 
@@ -202,102 +306,403 @@ void MainWindow::handleMapMarker(double latitude, double longitude) {
 }
 
 void MainWindow::onScanButtonClicked() {
-
-    if (!scanner) {
-        QMessageBox::warning(this, "Error", "No suitable scanner backend found!");
+    // The scan button cancels while a scan is in progress
+    if (scanInProgress) {
+        scanCancel.cancel();
+        statusBar()->showMessage("Cancelling scan...");
         return;
     }
-    cv::Mat scannedImage;
-    // Perform the scan (returns a large image that might contain multiple photos)
-    try {
-        scannedImage = scanner->scanImage();
-    } catch (const std::exception &e) {
-        QMessageBox::warning(this, "Error", "Failed to scan.");
+    // During a flatbed session it tells the session the next sheet is on the glass
+    if (scanSession && scanSession->isRunning()) {
+        ui->btnScan->setEnabled(false);
+        scanSession->nextSheet();
         return;
     }
 
-    if (scannedImage.empty()) {
+    // The preview resolution must be one the device supports and below the target
+    int dpi = projectData.scannerDpi;
+    ScannerInterface::Capabilities capabilities;
+    capabilityCache.lookup(ui->comboScanners->currentText(), capabilities);
+    int previewDpi = RegionScan::previewDpiFor(capabilities, dpi);
+    bool usePreview = ui->actionRegionScan->isChecked() && dpi > 0 && previewDpi > 0;
+    ScanProcessor::Options options = processorOptions;
+    ScanCancelToken cancel;
+    scanCancel = cancel;
+    setScanning(true);
+
+    ScannerWorker *worker = scannerWorker;
+    scannerWorker->submit([this, worker, usePreview, dpi, previewDpi, options, cancel](std::unique_ptr<ScannerInterface> &scanner) {
+        try {
+            if (!scanner) {
+                throw std::runtime_error("No suitable scanner backend found!");
+            }
+
+            int lastPercent = -1;
+            auto onProgress = [this, worker, &lastPercent](double fraction) {
+                int percent = qRound(fraction * 100);
+                if (percent == lastPercent) {
+                    return;
+                }
+                lastPercent = percent;
+                worker->post([this, percent]() {
+                    int photos = streamingDetector ? streamingDetector->photosFound() : 0;
+                    statusBar()->showMessage(QString("Scanning... %1%, %2 photos found").arg(percent).arg(photos));
+                });
+            };
+
+            // The whole bed is streamed without a preview, or when the device rejected one of the resolutions
+            if (usePreview) {
+                // The preview pass already found the photos, unless it found none
+                ScanProcessor processor(options);
+                RegionScan::Result regionScan = RegionScan::scan(*scanner, processor, dpi, cancel, onProgress, previewDpi);
+                if (!regionScan.previewed) {
+                    qWarning() << "Region scan not possible at" << dpi << "dpi, scanning the whole bed";
+                }
+                if (regionScan.previewed && !regionScan.image.empty() && regionScan.quads.empty()) {
+                    for (const auto &region : processor.detectAndCropPhotos(regionScan.image).regions) {
+                        regionScan.quads.push_back(region.corners);
+                    }
+                }
+                if (regionScan.previewed) {
+                    worker->post([this, regionScan]() {
+                        setScanning(false);
+                        statusBar()->clearMessage();
+                        if (regionScan.image.empty()) {
+                            QMessageBox::warning(this, "Error", "No image returned.");
+                            return;
+                        }
+                        showScan(regionScan.image, regionScan.quads);
+                    });
+                    return;
+                }
+            }
+
+            // Bands are converted here and painted and searched for photos on the GUI thread
+            auto onBand = [this, worker](const cv::Mat &band, int firstRow, int expectedRows) {
+                cv::Mat copy = band.clone();
+                QImage bandImage = matToQImage(copy);
+                worker->post([this, copy, bandImage, firstRow, expectedRows]() {
+                    addStreamedBand(copy, bandImage, firstRow, expectedRows);
+                });
+            };
+
+            cv::Mat image = scanner->scanImageStreamed(onBand, onProgress, cancel);
+            worker->post([this, image]() { streamedScanFinished(image); });
+        } catch (const ScanCancelled &) {
+            worker->post([this]() { scanFailed(QString(), true); });
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            worker->post([this, message]() { scanFailed(message, false); });
+        }
+    });
+}
+
+void MainWindow::setScanning(bool scanning) {
+    scanInProgress = scanning;
+    if (scanning) {
+        ui->btnScan->setText("Cancel");
+        streamingDetector.reset();
+    } else {
+        ui->btnScan->setText(scanButtonText);
+        ui->btnFindScanners->setEnabled(!scannerDiscovery->isDiscovering());
+    }
+
+    // Nothing that touches the scanner, the scan or the project may run in between
+    ui->btnSave->setEnabled(!scanning);
+    ui->comboScanners->setEnabled(!scanning);
+    if (scanning) {
+        ui->btnFindScanners->setEnabled(false);
+    }
+    ui->groupProperties->setEnabled(!scanning);
+    ui->menuScan->setEnabled(!scanning);
+    // The quads of the previous scan are replaced by the bands, or by the region scan's result
+    scanView->setEditingEnabled(!scanning);
+}
+
+void MainWindow::addStreamedBand(const cv::Mat &band, const QImage &bandImage, int firstRow, int expectedRows) {
+    // Photos are detected band by band, each one as soon as the head has passed its bottom edge
+    if (!streamingDetector) {
+        scanView->setScene(scanScene);
+        scanView->beginProgressiveScan(band.cols, expectedRows);
+        streamingDetector = std::make_unique<StreamingDetector>(processorOptions, band.cols, expectedRows);
+    }
+    scanView->addScanBand(bandImage, firstRow);
+    streamingDetector->addBand(band);
+}
+
+void MainWindow::streamedScanFinished(const cv::Mat &image) {
+    setScanning(false);
+    statusBar()->clearMessage();
+
+    if (image.empty()) {
         QMessageBox::warning(this, "Error", "No image returned.");
         return;
     }
 
-    scanImage = scannedImage;
+    std::vector<std::vector<cv::Point>> streamedQuads;
+    if (streamingDetector && streamingDetector->rowsReceived() == image.rows) {
+        for (const auto &region : streamingDetector->finish(image)) {
+            streamedQuads.push_back(region.corners);
+        }
+    } else {
+        // The backend did not deliver every row as a band
+        ScanProcessor processor(processorOptions);
+        for (const auto &region : processor.detectAndCropPhotos(image).regions) {
+            streamedQuads.push_back(region.corners);
+        }
+    }
+    streamingDetector.reset();
+
+    showScan(image, streamedQuads);
+}
+
+void MainWindow::scanFailed(const QString &message, bool cancelled) {
+    setScanning(false);
+    if (streamingDetector) {
+        // The bands replaced the previous scan and its quads
+        streamingDetector.reset();
+        scanScene->clear();
+        scanImage.release();
+        scanPyramid.reset();
+        thumbnails.clear();
+        rowPixmapKeys.clear();
+        croppedOrientation.clear();
+        croppedView->setItemCount(0);
+    }
+
+    if (cancelled) {
+        statusBar()->showMessage("Scan cancelled.", 5000);
+    } else {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Error", "Failed to scan: " + message);
+    }
+}
+
+void MainWindow::onScanSessionToggled(bool checked) {
+    if (!checked) {
+        if (scanSession) {
+            scanSession->stop();
+            statusBar()->showMessage("Stopping after the current sheet...");
+        }
+        return;
+    }
+
+    // Unchecked while the session finished its last sheet or was about to start, it still owns the scanner
+    if (scanSessionActive) {
+        QMessageBox::warning(this, "Error", "A scan session is already running.");
+        QSignalBlocker blocker(ui->actionScanSession);
+        ui->actionScanSession->setChecked(true);
+        return;
+    }
+    if (!ui->btnScan->isEnabled()) {
+        QMessageBox::warning(this, "Error", "Select a scanner before starting a session.");
+        QSignalBlocker blocker(ui->actionScanSession);
+        ui->actionScanSession->setChecked(false);
+        return;
+    }
+
+    // The session opens its own connection to the selected scanner on its scan thread. USB backends
+    // report a device that is open twice as busy, so the window's scanner is closed first.
+    std::wstring scannerName = QString::fromStdString(projectData.scannerName).toStdWString();
+    int dpi = projectData.scannerDpi;
+    int color = projectData.scannerColor;
+    bool useFeeder = ui->actionUseFeeder->isChecked();
+    ScanSession::ScannerFactory scannerFactory = [scannerName, dpi, color, useFeeder]() {
+        std::unique_ptr<ScannerInterface> sessionScanner = ScannerInterface::createScanner();
+        if (sessionScanner) {
+            sessionScanner->setPreferredScanner(scannerName);
+            if (useFeeder && !sessionScanner->setSource(ScannerInterface::Source::Feeder)) {
+                throw std::runtime_error("The selected scanner has no document feeder");
+            }
+            if (dpi > 0) {
+                sessionScanner->setDpi(dpi);
+            }
+            if (color > 0) {
+                sessionScanner->setColorOption(color);
+            }
+        }
+        return sessionScanner;
+    };
+
+    delete scanSession;
+    scanSession = new ScanSession(scannerFactory, processorOptions, 2, this);
 
-    // Use the ScanProcessor to detect & crop
-    ScanProcessor processor;
-    ScanResult scanResult = processor.detectAndCropPhotos(scannedImage);
+    connect(scanSession, &ScanSession::sheetScanned, this, [this](int index) {
+        statusBar()->showMessage(QString("Scanned sheet %1").arg(index + 1));
+    });
+    connect(scanSession, &ScanSession::sheetRequested, this, [this](int index) {
+        statusBar()->showMessage(QString("Place sheet %1 on the scanner and click Next sheet").arg(index + 1));
+        ui->btnScan->setEnabled(true);
+    });
+    connect(scanSession, &ScanSession::sheetReady, this, [this](const ScanSession::Sheet &sheet) {
+        // Each sheet is shown and saved as is, the scanner is already on the next one
+        showScan(sheet.image, sheet.quads);
+        QPointer<ScanSession> session = scanSession;
+        saveCurrentScan([this, session]() {
+            QMetaObject::invokeMethod(this, [session]() {
+                if (session) {
+                    session->sheetSaved();
+                }
+            }, Qt::QueuedConnection);
+        });
+    });
+    connect(scanSession, &ScanSession::failed, this, [this](const QString &message) {
+        QMessageBox::warning(this, "Error", "Scan session stopped: " + message);
+    });
+    connect(scanSession, &ScanSession::finished, this, [this](int sheets) {
+        statusBar()->showMessage(QString("Scan session finished after %1 sheets.").arg(sheets), 5000);
+        endScanSession();
+    });
+
+    // Sheets are saved automatically, manual scans and saves would race with the session. On the
+    // flatbed the scan button asks for the next sheet once the session requests it.
+    scanSessionActive = true;
+    ui->btnScan->setText("Next sheet");
+    ui->btnScan->setEnabled(false);
+    ui->btnSave->setEnabled(false);
+    // The window's scanner is closed until the session ends
+    ui->comboScanners->setEnabled(false);
+    ui->groupProperties->setEnabled(false);
+
+    ScannerWorker *worker = scannerWorker;
+    QPointer<ScanSession> session = scanSession;
+    scannerWorker->submit([this, worker, session, useFeeder](std::unique_ptr<ScannerInterface> &scanner) {
+        scanner.reset();
+        worker->post([this, session, useFeeder]() {
+            if (!session) {
+                return;
+            }
+            if (!ui->actionScanSession->isChecked()) {
+                // Stopped before it started
+                endScanSession();
+                return;
+            }
+            session->start(0, useFeeder);
+        });
+    });
+}
+
+void MainWindow::endScanSession() {
+    scanSessionActive = false;
+    QSignalBlocker blocker(ui->actionScanSession);
+    ui->actionScanSession->setChecked(false);
+    ui->btnScan->setText(scanButtonText);
+    ui->btnScan->setEnabled(true);
+    ui->btnSave->setEnabled(true);
+    ui->comboScanners->setEnabled(true);
+    ui->groupProperties->setEnabled(true);
+
+    // Open the window's scanner again with the project's settings
+    QString scannerName = ui->comboScanners->currentText();
+    int dpi = projectData.scannerDpi;
+    int color = projectData.scannerColor;
+    ScannerWorker *worker = scannerWorker;
+    scannerWorker->submit([this, worker, scannerName, dpi, color](std::unique_ptr<ScannerInterface> &scanner) {
+        try {
+            scanner = ScannerInterface::createScanner();
+            if (!scanner) {
+                throw std::runtime_error("No suitable scanner backend found!");
+            }
+            scanner->setPreferredScanner(scannerName.toStdWString());
+            if (dpi > 0) {
+                scanner->setDpi(dpi);
+            }
+            if (color > 0) {
+                scanner->setColorOption(color);
+            }
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            worker->post([this, scannerName, message]() { scannerFailed(scannerName, message); });
+        }
+    });
+}
+
+void MainWindow::showScan(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>> &detectedQuads) {
+    scanImage = scannedImage;
+    scanPyramid = std::make_shared<ScanPyramid>(scanImage);
+    thumbnails.clear();
+    rowPixmapKeys.clear();
+    croppedView->setItemCount(0);
 
     // Display the scanned image in the graphics view
-    MainWindow::displayMatInGraphicsView(scanResult.annotated, scanView, scanScene);
+    MainWindow::displayMatInGraphicsView(scanPyramid, scanView, scanScene);
     scanView->rotate(projectData.scanOrientation);
 
     // Add rectangles to the scanScene
-    std::vector<std::vector<cv::Point>> quads;
-    for (const auto &region : scanResult.regions) {
-        scanView->addQuadrilateral(region.corners);
-        quads.push_back(region.corners);
+    for (const auto &quad : detectedQuads) {
+        scanView->addQuadrilateral(quad);
     }
+    // Clearing the scene reported the quads of the previous scan as removed
+    scanView->discardQuadChanges();
 
     // Update the list of thumbnails
-    updateThumbnailsList(quads);
+    updateThumbnailsList(detectedQuads);
 }
 
 void MainWindow::onSaveButtonClicked() {
+    saveCurrentScan();
+}
+
+void MainWindow::saveCurrentScan(std::function<void()> onSaved) {
+    // Flush pending quad edits so croppedOrientation matches the quads
+    scanView->updateQuads();
+
     std::vector<std::vector<cv::Point>> quads;
     scanView->getQuads(quads);
+    // croppedOrientation is indexed in thumbnail order
+    sortQuadsByCenter(quads);
 
-    ScanProcessor processor;
-    std::vector<cv::Mat> croppedImages = processor.cropImages(scanImage, quads, projectData.scanOrientation, croppedOrientation);
-
-    // save images
-    ImageSaver imageSaver;
-    for (size_t i = 0; i < croppedImages.size(); ++i) {
+    // File names and counts are reserved here, the photos are cropped, encoded and written in the background
+    std::vector<SaveQueue::Job> jobs;
+    for (size_t i = 0; i < quads.size(); ++i) {
         projectData.imagesCount++;
         QString file_name = QString::fromStdString(projectData.projectName) + "_" + QString::number(projectData.imagesCount) + ".jpg";
         QString file_path_name = QString::fromStdString(projectData.projectPath) + "/" + file_name;
 
-        QDateTime *dt = new QDateTime(QDateTime::fromString(QString::fromStdString(projectData.imageDateTime), Qt::ISODate));
+        QDateTime dt = QDateTime::fromString(QString::fromStdString(projectData.imageDateTime), Qt::ISODate);
 
         // add 60 seconds
-        QDateTime newDateTime = dt->addSecs(60);
+        QDateTime newDateTime = dt.addSecs(60);
         ui->dateTimeEdit->setDateTime(newDateTime);
 
-        imageSaver.saveImage(croppedImages[i], file_path_name, QString::fromStdString(projectData.imageDateTime), projectData.imageLocation);
+        int orientation = i < croppedOrientation.size() ? croppedOrientation[i] : -1;
+        jobs.push_back({scanImage, quads[i], orientation, file_path_name,
+                        QString::fromStdString(projectData.imageDateTime), projectData.imageLocation});
     }
     ui->projectCount->display(projectData.imagesCount);
     saveProjectData();
+
+    saveQueue->enqueue(std::move(jobs), std::move(onSaved));
 }
 
 void MainWindow::onFindScannerButtonClicked() {
-    try {
-        if (!scanner) {
-            scanner = ScannerInterface::createScanner();
-        }
-
-        if (!scanner) {
-            QMessageBox::warning(this, "Error", "No suitable scanner backend found!");
-            return;
-        }
+    ui->btnFindScanners->setEnabled(false);
+    statusBar()->showMessage("Looking for scanners...");
+    scannerDiscovery->discover();
+}
 
-        // std::vector<std::wstring> scanners = scanner->getAvailableScanners();
-        std::vector<std::wstring> scanners = scanner->getAvailableScanners();
+void MainWindow::fillScannerList(const QStringList &scanners) {
+    QString selected = ui->comboScanners->currentText();
 
-        if (scanners.empty()) {
-            QMessageBox::information(this, "Info", "No scanners found.");
-            return;
-        }
+    int index = -1;
+    {
+        // Rebuilding the list must not reopen the selected scanner
+        QSignalBlocker blocker(ui->comboScanners);
 
         // add to combo box
         QStringList scannerList;
         scannerList += QString("-");
-        for (const auto &scanner : scanners) {
-            scannerList += QString::fromStdWString(scanner);
-        }
+        scannerList += scanners;
 
         ui->comboScanners->clear();
         ui->comboScanners->addItems(scannerList);
-    } catch (const std::exception &e) {
-        QMessageBox::warning(this, "Initialization Error", QString::fromStdString(e.what()));
+        index = ui->comboScanners->findText(selected);
+        ui->comboScanners->setCurrentIndex(std::max(index, 0));
+    }
+
+    // The selected scanner is gone
+    if (index < 0 && !selected.isEmpty() && selected != "-") {
+        onScannerSelectionChanged(ui->comboScanners->currentText());
     }
 }
 
@@ -307,70 +712,135 @@ void MainWindow::onScannerSelectionChanged(QString scannerName) {
         ui->groupProperties->setEnabled(false);
         return;
     }
-    try {
-        if (!scanner) {
-            QMessageBox::warning(this, "Error", "No suitable scanner backend found!");
-            return;
-        }
 
-        std::wstring scannerNameW = scannerName.toStdWString();
+    projectData.scannerName = scannerName.toStdString();
 
-        projectData.scannerName = scannerName.toStdString();
+    std::cout << "Selected scanner: " << scannerName.toStdString() << std::endl;
 
-        std::cout << "Selected scanner: " << scannerName.toStdString() << std::endl;
+    ui->btnScan->setEnabled(true);
+    ui->groupProperties->setEnabled(true);
 
-        scanner->setPreferredScanner(scannerNameW);
+    // Offer what the device supported last time, and ask it again once it is open
+    ScannerInterface::Capabilities capabilities;
+    if (!capabilityCache.lookup(scannerName, capabilities)) {
+        capabilities.hasFeeder = true; // Unknown until queried, nothing is disabled
+    }
+    applyCapabilities(capabilities);
+    bool revalidate = capabilityCache.needsRevalidation(scannerName);
 
-        ui->btnScan->setEnabled(true);
-        ui->groupProperties->setEnabled(true);
-    } catch (const std::exception &e) {
-        QMessageBox::warning(this, "Error", QString::fromStdString(e.what()));
+    // Scans and settings submitted later queue behind the open
+    ScannerWorker *worker = scannerWorker;
+    scannerWorker->submit([this, worker, scannerName, revalidate](std::unique_ptr<ScannerInterface> &scanner) {
+        try {
+            if (!scanner) {
+                scanner = ScannerInterface::createScanner();
+            }
+            if (!scanner) {
+                throw std::runtime_error("No suitable scanner backend found!");
+            }
+            scanner->setPreferredScanner(scannerName.toStdWString());
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            worker->post([this, scannerName, message]() { scannerFailed(scannerName, message); });
+            return;
+        }
+
+        if (!revalidate) {
+            return;
+        }
+        try {
+            ScannerInterface::Capabilities queried = scanner->queryCapabilities();
+            worker->post([this, scannerName, queried]() {
+                capabilityCache.store(scannerName, queried);
+                // The selection may have moved on in the meantime
+                if (ui->comboScanners->currentText() == scannerName) {
+                    applyCapabilities(queried);
+                }
+            });
+        } catch (const std::exception &e) {
+            qWarning() << "Failed to query the capabilities of" << scannerName << ":" << e.what();
+        }
+    });
+}
+
+void MainWindow::scannerFailed(const QString &scannerName, const QString &message) {
+    QMessageBox::warning(this, "Error", message);
+    if (ui->comboScanners->currentText() == scannerName) {
         ui->groupProperties->setEnabled(false);
         ui->comboScanners->setCurrentIndex(0);
         ui->btnScan->setEnabled(false);
     }
 }
 
+void MainWindow::applyCapabilities(const ScannerInterface::Capabilities &capabilities) {
+    // Entry 0 of both combo boxes is "-", the others follow onDpiOptionChanged and setColorOption
+    const int dpis[] = {100, 200, 300, 600};
+    if (auto *model = qobject_cast<QStandardItemModel *>(ui->comboDPI->model())) {
+        for (int i = 0; i < 4 && i + 1 < model->rowCount(); i++) {
+            model->item(i + 1)->setEnabled(capabilities.supportsDpi(dpis[i]));
+        }
+    }
+    if (auto *model = qobject_cast<QStandardItemModel *>(ui->comboColor->model())) {
+        for (int i = 1; i < model->rowCount(); i++) {
+            model->item(i)->setEnabled(capabilities.supportsColorOption(i));
+        }
+    }
+
+    ui->actionUseFeeder->setEnabled(capabilities.hasFeeder);
+}
+
 void MainWindow::onColorOptionChanged(int index) {
-    if (index > 0) {
+    if (index <= 0) {
+        return;
+    }
+    projectData.scannerColor = index;
+
+    ScannerWorker *worker = scannerWorker;
+    scannerWorker->submit([this, worker, index](std::unique_ptr<ScannerInterface> &scanner) {
         try {
+            if (!scanner) {
+                throw std::runtime_error("No scanner selected");
+            }
             scanner->setColorOption(index);
-            projectData.scannerColor = index;
         } catch (const std::exception &e) {
-            QMessageBox::warning(this, "Error", QString::fromStdString(e.what()));
-            projectData.scannerColor = 0;
-            ui->comboColor->setCurrentIndex(0);
+            QString message = QString::fromStdString(e.what());
+            worker->post([this, index, message]() {
+                QMessageBox::warning(this, "Error", message);
+                if (ui->comboColor->currentIndex() == index) {
+                    projectData.scannerColor = 0;
+                    ui->comboColor->setCurrentIndex(0);
+                }
+            });
         }
-    }
+    });
 }
 
 void MainWindow::onDpiOptionChanged(int index) {
-    try {
-        switch (index) {
-        case 1:
-            scanner->setDpi(100);
-            projectData.scannerDpi = 100;
-            break;
-        case 2:
-            scanner->setDpi(200);
-            projectData.scannerDpi = 200;
-            break;
-        case 3:
-            scanner->setDpi(300);
-            projectData.scannerDpi = 300;
-            break;
-        case 4:
-            scanner->setDpi(600);
-            projectData.scannerDpi = 600;
-            break;
-
-        default:
-            break;
-        }
-    } catch (const std::exception &e) {
-        QMessageBox::warning(this, "Error", QString::fromStdString(e.what()));
-        ui->comboDPI->setCurrentIndex(0);
+    // Entry 0 is "-"
+    const int dpis[] = {100, 200, 300, 600};
+    if (index < 1 || index > 4) {
+        return;
     }
+    int dpi = dpis[index - 1];
+    projectData.scannerDpi = dpi;
+
+    ScannerWorker *worker = scannerWorker;
+    scannerWorker->submit([this, worker, index, dpi](std::unique_ptr<ScannerInterface> &scanner) {
+        try {
+            if (!scanner) {
+                throw std::runtime_error("No scanner selected");
+            }
+            scanner->setDpi(dpi);
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            worker->post([this, index, message]() {
+                QMessageBox::warning(this, "Error", message);
+                if (ui->comboDPI->currentIndex() == index) {
+                    ui->comboDPI->setCurrentIndex(0);
+                }
+            });
+        }
+    });
 }
 
 void MainWindow::updateThumbnailsList(std::vector<std::vector<cv::Point>> quads) {
@@ -398,48 +868,150 @@ void MainWindow::updateThumbnailsList(std::vector<std::vector<cv::Point>> quads)
     }
 
     qDebug() << "Updating thumbnails list with " << quads.size() << " quadrilaterals.";
-    // Clear the existing listview
-    croppedView->model()->removeRows(0, croppedView->model()->rowCount());
 
-    // Use the ScanProcessor to crop the images
-    ScanProcessor processor;
-    croppedImages = processor.cropImages(scanImage, quads, projectData.scanOrientation, croppedOrientation);
+    // Reuse the thumbnails whose quad and orientation did not change, crop only the rest
+    std::vector<Thumbnail> previous;
+    previous.swap(thumbnails);
+
+    std::vector<PreviewTask> tasks;
+    for (size_t index = 0; index < quads.size(); ++index) {
+        auto cached = std::find_if(previous.begin(), previous.end(), [&](const Thumbnail &thumbnail) {
+            return !thumbnail.pending && !thumbnail.pixmap.isNull() &&
+                   thumbnail.orientation == croppedOrientation[index] && thumbnail.quad == quads[index];
+        });
+
+        if (cached != previous.end()) {
+            thumbnails.push_back(*cached);
+            cached->pixmap = QPixmap(); // Each cached thumbnail is used once
+        } else {
+            thumbnails.push_back({quads[index], croppedOrientation[index], QPixmap(), true});
+            tasks.push_back({quads[index], croppedOrientation[index]});
+        }
+    }
+
+    // Only touch the rows that now show a different thumbnail
+    croppedView->setItemCount(static_cast<int>(thumbnails.size()));
+    rowPixmapKeys.resize(thumbnails.size(), 0);
+    for (size_t index = 0; index < thumbnails.size(); ++index) {
+        if (!thumbnails[index].pending) {
+            showThumbnail(static_cast<int>(index));
+        }
+    }
+
+    // The changed regions are cropped off the GUI thread
+    startPreviewJob(std::move(tasks));
+}
+
+void MainWindow::startPreviewJob(std::vector<PreviewTask> tasks) {
+    quint64 generation = ++*previewGeneration;
+    if (tasks.empty() || !scanPyramid) {
+        return;
+    }
+
+    // Crop from the smallest pyramid level that still fills the thumbnail strip,
+    // full resolution crops are only made when saving
+    ScanProcessor::Options previewOptions = processorOptions;
+    previewOptions.cropInterpolation = cv::INTER_NEAREST;
+    int thumbnailHeight = std::max(1, static_cast<int>(croppedView->height() * 0.9));
 
-    // Display the cropped images in the list
-    for (size_t index = 0; index < croppedImages.size(); ++index) {
-        const auto &cropped = croppedImages[index];
+    std::shared_ptr<ScanPyramid> pyramid = scanPyramid;
+    std::shared_ptr<std::atomic<quint64>> latestGeneration = previewGeneration;
 
-        // Convert cv::Mat to QImage
-        QImage qImage = matToQImage(cropped);
+    QtConcurrent::run(&previewPool, [this, tasks, pyramid, latestGeneration, generation, previewOptions, thumbnailHeight]() {
+        ScanProcessor processor(previewOptions);
 
-        // Convert QImage to QPixmap
-        QPixmap pixmap = QPixmap::fromImage(qImage);
+        for (const auto &task : tasks) {
+            // Superseded by a newer edit, its job will crop whatever is still needed
+            if (latestGeneration->load() != generation) {
+                return;
+            }
 
-        // Pass index to addImageItem if needed
-        croppedView->addImageItem(pixmap, index);
+            int level = previewLevelFor(task.quad, thumbnailHeight);
+            double scale = 1.0 / (1 << level);
+            std::vector<cv::Point> levelQuad;
+            for (const auto &point : task.quad) {
+                levelQuad.emplace_back(cvRound((point.x + 0.5) * scale - 0.5), cvRound((point.y + 0.5) * scale - 0.5));
+            }
+
+            QImage image;
+            try {
+                image = matToQImage(processor.cropImage(pyramid->level(level), levelQuad, task.orientation));
+            } catch (const std::exception &e) {
+                qWarning() << "Preview crop failed:" << e.what();
+            }
+
+            // QPixmaps can only be made on the GUI thread
+            QMetaObject::invokeMethod(this, [this, pyramid, task, image]() {
+                applyPreview(pyramid.get(), task.quad, task.orientation, image);
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void MainWindow::applyPreview(const ScanPyramid *source, const std::vector<cv::Point> &quad, int orientation, const QImage &image) {
+    // Cropped from a scan that has since been replaced, the same quad on the new scan shows other pixels
+    if (source != scanPyramid.get()) {
+        return;
+    }
+
+    // Results of cancelled jobs are still valid for any row waiting on the same quad and orientation
+    for (size_t index = 0; index < thumbnails.size(); ++index) {
+        Thumbnail &thumbnail = thumbnails[index];
+        if (thumbnail.pending && thumbnail.orientation == orientation && thumbnail.quad == quad) {
+            thumbnail.pixmap = QPixmap::fromImage(image);
+            thumbnail.pending = false;
+            showThumbnail(static_cast<int>(index));
+            return;
+        }
+    }
+}
+
+void MainWindow::showThumbnail(int index) {
+    qint64 key = thumbnails[index].pixmap.cacheKey();
+    if (rowPixmapKeys[index] != key) {
+        croppedView->setImageItem(index, thumbnails[index].pixmap);
+        rowPixmapKeys[index] = key;
     }
-    croppedView->manualResize();
 }
 
 void MainWindow::saveProjectData() {
-    Project::updateProject(projectPath, projectData);
+    // Synced on the writer thread, the GUI never waits for the disk
+    std::string path = projectPath;
+    Project::ProjectData data = projectData;
+    saveQueue->enqueueWrite([path, data]() {
+        if (!Project::updateProject(path, data)) {
+            qWarning() << "Failed to save the project file in" << QString::fromStdString(path);
+        }
+    });
 }
 
-void MainWindow::displayMatInGraphicsView(const cv::Mat &mat, ImageEditorView *graphicsView, QGraphicsScene *scene) {
+int MainWindow::previewLevelFor(const std::vector<cv::Point> &quad, int thumbnailHeight) {
+    constexpr int maxPreviewLevel = 5;
+
+    // Whichever side ends up vertical must still cover the strip height
+    cv::RotatedRect rect = cv::minAreaRect(quad);
+    double shortSide = std::min(rect.size.width, rect.size.height);
+
+    int level = 0;
+    while (level < maxPreviewLevel && shortSide / (2 << level) >= thumbnailHeight) {
+        level++;
+    }
+    return level;
+}
+
+void MainWindow::displayMatInGraphicsView(const std::shared_ptr<ScanPyramid> &pyramid, ImageEditorView *graphicsView, QGraphicsScene *scene) {
+    const cv::Mat &mat = pyramid->image();
     qDebug() << "Mat empty:" << mat.empty();
     qDebug() << "Mat type:" << mat.type();
     qDebug() << "Mat rows:" << mat.rows << ", cols:" << mat.cols;
-    // Convert cv::Mat to QImage
-    // Handle supported formats
-    QImage qImage = matToQImage(mat);
-
-    // Convert QImage to QPixmap
-    QPixmap pixmap = QPixmap::fromImage(qImage);
 
-    // clear scene
+    // clear scene, and let it size itself to the image again after a progressive scan
     scene->clear();
+    scene->setSceneRect(QRectF());
 
-    scene->addPixmap(pixmap);
+    // Tiles of the pyramid level matching the zoom, a full resolution pixmap of a 600 dpi scan
+    // is hundreds of megabytes and would be scaled down on every repaint
+    scene->addItem(new ScanTileItem(pyramid));
 
     // Set the scene to the graphics view
     graphicsView->setScene(scene);
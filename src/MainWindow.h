@@ -1,9 +1,14 @@
 #pragma once
 
+#include "ScanProcessor.h"
 #include "ScannerInterface.h"
 #include "ui_MainWindow.h"
 #include <QMainWindow>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
 #include "Project.h"
+#include "ScannerCapabilityCache.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -13,6 +18,12 @@ QT_END_NAMESPACE
 
 class ImageEditorView; // Forward declaration
 class CroppedView;     // Forward declaration
+class ScanPyramid;     // Forward declaration
+class SaveQueue;       // Forward declaration
+class ScanSession;     // Forward declaration
+class ScannerDiscovery; // Forward declaration
+class ScannerWorker;    // Forward declaration
+class StreamingDetector; // Forward declaration
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -36,6 +47,7 @@ private slots:
     void onColorOptionChanged(int index);
     void onDpiOptionChanged(int index);
     void updateThumbnailsList(std::vector<std::vector<cv::Point>> quads);
+    void onScanSessionToggled(bool checked);
 
 private:
     Ui::MainWindow *ui;
@@ -43,19 +55,71 @@ private:
     Project::ProjectData projectData;
     std::string projectPath;
 
-    std::unique_ptr<ScannerInterface> scanner;
+    ScannerWorker *scannerWorker; // Owns the scanner, created when one is selected
+    ScannerDiscovery *scannerDiscovery;
+    ScannerCapabilityCache capabilityCache;
     ImageEditorView *scanView;
     QGraphicsScene *scanScene;
     CroppedView *croppedView;
 
     cv::Mat scanImage;
-
-    std::vector<cv::Mat> croppedImages;
+    std::shared_ptr<ScanPyramid> scanPyramid; // scanImage halved per level, built on demand for the view tiles and the thumbnails
+    ScanProcessor::Options processorOptions;
+    SaveQueue *saveQueue;
+    ScanSession *scanSession = nullptr;
+    bool scanSessionActive = false; // From the start of a session until endScanSession, the scan button asks for sheets
+
+    // Thumbnail shown in each CroppedView row, keyed by the quad and orientation it was cropped with
+    struct Thumbnail {
+        std::vector<cv::Point> quad;
+        int orientation;
+        QPixmap pixmap;
+        bool pending; // Being cropped by a preview job, the row still shows its previous pixmap
+    };
+    std::vector<Thumbnail> thumbnails;
+    std::vector<qint64> rowPixmapKeys; // cacheKey of the pixmap each CroppedView row shows
     std::vector<int> croppedOrientation;
 
+    // Preview crops run on previewPool. Each update bumps previewGeneration and jobs from an
+    // older generation stop before their next crop.
+    struct PreviewTask {
+        std::vector<cv::Point> quad;
+        int orientation;
+    };
+    QThreadPool previewPool;
+    std::shared_ptr<std::atomic<quint64>> previewGeneration;
+
+    // Scans run on scannerWorker. Streamed bands are painted in scanView and searched for photos
+    // as they arrive, the scan button cancels while a scan is in progress.
+    bool scanInProgress = false;
+    ScanCancelToken scanCancel;
+    QString scanButtonText; // From the .ui, restored after a scan or a session
+    std::unique_ptr<StreamingDetector> streamingDetector; // Created with the first band
+
     void saveProjectData();
 
-    static void displayMatInGraphicsView(const cv::Mat &mat, ImageEditorView *graphicsView, QGraphicsScene *scene);
+    void setScanning(bool scanning);
+    void addStreamedBand(const cv::Mat &band, const QImage &bandImage, int firstRow, int expectedRows);
+    void streamedScanFinished(const cv::Mat &image);
+    void scanFailed(const QString &message, bool cancelled);
+
+    // Restores the controls a session took over and reopens the window's scanner
+    void endScanSession();
+
+    void fillScannerList(const QStringList &scanners);
+    void scannerFailed(const QString &scannerName, const QString &message);
+    void applyCapabilities(const ScannerInterface::Capabilities &capabilities);
+
+    void showScan(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>> &detectedQuads);
+    // Reserves names for the current quads and hands them to saveQueue, onSaved runs once they are written
+    void saveCurrentScan(std::function<void()> onSaved = {});
+
+    void startPreviewJob(std::vector<PreviewTask> tasks);
+    void applyPreview(const ScanPyramid *source, const std::vector<cv::Point> &quad, int orientation, const QImage &image);
+    void showThumbnail(int index);
+    static int previewLevelFor(const std::vector<cv::Point> &quad, int thumbnailHeight);
+
+    static void displayMatInGraphicsView(const std::shared_ptr<ScanPyramid> &pyramid, ImageEditorView *graphicsView, QGraphicsScene *scene);
     static QImage matToQImage(const cv::Mat &mat);
 
     static cv::Point2f computeCentroid(const std::vector<cv::Point>& quad);
@@ -43,6 +43,8 @@ QJsonObject Project::toJson(const ProjectData &data) {
     imageLocationObj["lat"] = data.imageLocation.first;
     imageLocationObj["lon"] = data.imageLocation.second;
     obj["imageLocation"] = imageLocationObj;
+    obj["saveDurability"] = durabilityName(data.saveDurability);
+    obj["orientationInExif"] = data.orientationInExif;
 
     return obj;
 }
@@ -70,10 +72,34 @@ Project::ProjectData Project::fromJson(const QJsonObject &obj) {
         // Handle missing or invalid imageLocation
         data.imageLocation = std::make_pair(0.0, 0.0); // Default values
     }
+    data.saveDurability = durabilityFromName(obj["saveDurability"].toString());
+    data.orientationInExif = obj["orientationInExif"].toBool(false);
 
     return data;
 }
 
+QString Project::durabilityName(AtomicFile::Durability durability) {
+    switch (durability) {
+    case AtomicFile::Durability::None:
+        return "none";
+    case AtomicFile::Durability::EveryFile:
+        return "everyFile";
+    default:
+        return "batch";
+    }
+}
+
+// Missing or unknown names fall back to the default
+AtomicFile::Durability Project::durabilityFromName(const QString &name) {
+    if (name == "none") {
+        return AtomicFile::Durability::None;
+    }
+    if (name == "everyFile") {
+        return AtomicFile::Durability::EveryFile;
+    }
+    return AtomicFile::Durability::Batch;
+}
+
 // Load project data from JSON file
 Project::ProjectData Project::loadProject(const std::string &folderPath) {
     std::string filePath = folderPath + "/project.json";
@@ -91,6 +117,9 @@ Project::ProjectData Project::loadProject(const std::string &folderPath) {
         throw std::runtime_error("Invalid JSON structure in file: " + filePath);
     }
 
+    // Photos and project.json that were being written when the application crashed or lost power
+    AtomicFile::removeTemporaryFiles(QString::fromStdString(folderPath));
+
     return fromJson(doc.object());
 }
 
@@ -138,15 +167,9 @@ bool Project::checkProject(const std::string &folderPath) {
 // Update project data in JSON file
 bool Project::updateProject(const std::string &folderPath, const ProjectData &data) {
     std::string filePath = folderPath + "/project.json";
-    QFile file(QString::fromStdString(filePath));
-    if (!file.open(QIODevice::WriteOnly)) {
-        return false;
-    }
 
     QJsonObject obj = toJson(data);
     QJsonDocument doc(obj);
-    file.write(doc.toJson());
-    file.close();
 
-    return true;
+    return AtomicFile::write(QString::fromStdString(filePath), doc.toJson(), data.saveDurability);
 }
@@ -1,6 +1,7 @@
 #ifndef PROJECT_H
 #define PROJECT_H
 
+#include "AtomicFile.h"
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -20,6 +21,10 @@ public:
         int scanOrientation;
         std::string imageDateTime;
         std::pair<double, double> imageLocation;
+        // How hard saving works to survive a power loss, older projects get the default
+        AtomicFile::Durability saveDurability = AtomicFile::Durability::Batch;
+        // Right-angle turns go into the Exif Orientation tag instead of the pixels, see SaveQueue::OrientationMode
+        bool orientationInExif = false;
     };
 
     // Load project data from JSON file
@@ -28,7 +33,8 @@ public:
     // Check if a file contains a valid project structure
     static bool checkProject(const std::string &folderPath);
 
-    // Update project data in JSON file
+    // Update project data in JSON file, replaced atomically so a crash never leaves it half written.
+    // Synced as data.saveDurability asks.
     static bool updateProject(const std::string &folderPath, const ProjectData &data);
 
     static bool createProject(const std::string &basePath, const std::string &projectName);
@@ -39,6 +45,9 @@ private:
 
     // Helper function to convert QJsonObject to ProjectData
     static ProjectData fromJson(const QJsonObject &obj);
+
+    static QString durabilityName(AtomicFile::Durability durability);
+    static AtomicFile::Durability durabilityFromName(const QString &name);
 };
 
 #endif // PROJECT_H
@@ -0,0 +1,100 @@
+#include "QuadFitter.h"
+#include <algorithm>
+#include <limits>
+
+QuadFit QuadFitter::fit(const std::vector<cv::Point> &contour) {
+    double perimeter = cv::arcLength(contour, true);
+    int approximations = 0;
+    std::vector<cv::Point> best;
+
+    // 1. Sweep down in coarse steps. The vertex count of approxPolyDP does not strictly grow as epsilon
+    //    shrinks (its merge pass can turn 5 vertices into 3 and back into 4), so a bisection could stop
+    //    at a different epsilon than fitLinearSweep
+    int hit = 0;
+    int previous = maxEpsilonSteps + 1;
+    for (int eps = maxEpsilonSteps;; eps = std::max(1, eps - coarseStep)) {
+        approximations++;
+        if (approximate(contour, perimeter, eps, best)) {
+            hit = eps;
+            break;
+        }
+        if (eps == 1) {
+            QuadFit none;
+            none.approximations = approximations;
+            return none;
+        }
+        previous = eps;
+    }
+
+    // 2. The steps skipped between the last miss and the hit, from the top like the linear sweep
+    std::vector<cv::Point> approx;
+    for (int eps = previous - 1; eps > hit; eps--) {
+        approximations++;
+        if (approximate(contour, perimeter, eps, approx)) {
+            best.swap(approx);
+            break;
+        }
+    }
+
+    return makeFit(contour, best, approximations);
+}
+
+QuadFit QuadFitter::fitLinearSweep(const std::vector<cv::Point> &contour) {
+    double perimeter = cv::arcLength(contour, true);
+    int approximations = 0;
+
+    for (int eps = maxEpsilonSteps; eps > 0; eps--) {
+        std::vector<cv::Point> approx;
+        approximations++;
+        if (approximate(contour, perimeter, eps, approx)) {
+            return makeFit(contour, approx, approximations);
+        }
+    }
+
+    QuadFit none;
+    none.approximations = approximations;
+    return none;
+}
+
+double QuadFitter::fitError(const std::vector<cv::Point> &contour, const std::vector<cv::Point2f> &quad) {
+    if (contour.empty() || quad.size() != 4) {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (const auto &point : contour) {
+        cv::Point2f p(static_cast<float>(point.x), static_cast<float>(point.y));
+        double nearest = std::numeric_limits<double>::max();
+
+        // Distance to the closest of the 4 edge segments
+        for (int i = 0; i < 4; i++) {
+            cv::Point2f a = quad[i];
+            cv::Point2f ab = quad[(i + 1) % 4] - a;
+            double lengthSq = ab.dot(ab);
+            double t = lengthSq > 0 ? std::clamp((p - a).dot(ab) / lengthSq, 0.0, 1.0) : 0.0;
+            cv::Point2f closest = a + ab * static_cast<float>(t);
+            nearest = std::min(nearest, cv::norm(p - closest));
+        }
+        total += nearest;
+    }
+
+    return total / contour.size();
+}
+
+bool QuadFitter::approximate(const std::vector<cv::Point> &contour, double perimeter, int eps, std::vector<cv::Point> &approx) {
+    cv::approxPolyDP(contour, approx, 0.001 * eps * perimeter, true);
+    return approx.size() > 3;
+}
+
+QuadFit QuadFitter::makeFit(const std::vector<cv::Point> &contour, const std::vector<cv::Point> &approx, int approximations) {
+    QuadFit result;
+    result.approximations = approximations;
+
+    cv::RotatedRect rotRect = cv::minAreaRect(approx);
+    cv::Point2f vertices[4];
+    rotRect.points(vertices);
+
+    result.corners.assign(vertices, vertices + 4);
+    result.fitError = fitError(contour, result.corners);
+    return result;
+}
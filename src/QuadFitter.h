@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Result of fitting a quadrilateral to a contour:
+ *  - corners: the 4 corners of the fitted rectangle, empty if no quad was found
+ *  - fitError: mean distance in pixels from the contour points to the quad outline
+ *  - approximations: number of approxPolyDP calls it took
+ */
+struct QuadFit
+{
+    std::vector<cv::Point2f> corners;
+    double fitError = 0.0;
+    int approximations = 0;
+};
+
+class QuadFitter
+{
+public:
+    // Largest epsilon (as 0.1% steps of the perimeter) that still leaves at least 4 vertices, found with
+    // a sweep in coarseStep steps and a single step search below the last miss, at most ~70 approximations.
+    // Matches fitLinearSweep unless 4 vertices appear only within a gap of the coarse sweep above the hit.
+    // Sweeping the convex hull instead is faster but keeps cut corners and picks other quads, see tst_quadfitter.
+    static QuadFit fit(const std::vector<cv::Point> &contour);
+
+    // The original sweep from 50% of the perimeter down in 0.1% steps, up to 500 approximations
+    static QuadFit fitLinearSweep(const std::vector<cv::Point> &contour);
+
+    static double fitError(const std::vector<cv::Point> &contour, const std::vector<cv::Point2f> &quad);
+
+private:
+    static constexpr int maxEpsilonSteps = 500;
+    static constexpr int coarseStep = 8;
+
+    static bool approximate(const std::vector<cv::Point> &contour, double perimeter, int eps, std::vector<cv::Point> &approx);
+    static QuadFit makeFit(const std::vector<cv::Point> &contour, const std::vector<cv::Point> &approx, int approximations);
+};
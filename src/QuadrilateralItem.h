@@ -22,6 +22,7 @@ public:
     std::vector<cv::Point> getCorners();
 
 signals:
+    // Emitted on every corner move while dragging and once more on release
     void positionChanged();
     void deletePressed(QuadrilateralItem *quad);
 
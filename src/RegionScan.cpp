@@ -0,0 +1,138 @@
+#include "RegionScan.h"
+
+#include <QDebug>
+#include <algorithm>
+#include <cstdlib>
+
+RegionScan::Result RegionScan::scan(ScannerInterface &scanner, ScanProcessor &processor, int targetDpi, const ScanCancelToken &cancel,
+                                    const ScannerInterface::ProgressCallback &onProgress, int previewDpi, double marginInches) {
+    Result result;
+
+    // Both resolutions must be accepted before anything is scanned
+    auto trySetDpi = [&scanner](int dpi) {
+        try {
+            scanner.setDpi(dpi);
+            return true;
+        } catch (const std::exception &e) {
+            qWarning() << "RegionScan: the scanner rejected" << dpi << "dpi:" << e.what();
+            return false;
+        }
+    };
+    if (previewDpi <= 0 || previewDpi >= targetDpi || !trySetDpi(targetDpi)) {
+        return result;
+    }
+
+    auto passProgress = [&onProgress](double start, double share) -> ScannerInterface::ProgressCallback {
+        if (!onProgress) {
+            return {};
+        }
+        return [&onProgress, start, share](double fraction) { onProgress(start + share * fraction); };
+    };
+
+    // Pass 1: the whole bed at preview resolution
+    scanner.clearScanArea();
+    if (!trySetDpi(previewDpi)) {
+        scanner.setDpi(targetDpi);
+        return result;
+    }
+    cv::Mat preview;
+    try {
+        preview = scanner.scanImageStreamed({}, passProgress(0.0, 0.25), cancel);
+    } catch (...) {
+        scanner.setDpi(targetDpi);
+        throw;
+    }
+    if (preview.empty()) {
+        scanner.setDpi(targetDpi);
+        return result;
+    }
+    result.previewed = true;
+
+    std::vector<std::vector<cv::Point>> previewQuads;
+    for (const auto &region : processor.detectAndCropPhotos(preview).regions) {
+        previewQuads.push_back(region.corners);
+    }
+
+    // Pass 2: only the photos at the target resolution, or the whole bed when nothing was found
+    // or the backend cannot restrict the area
+    scanner.setDpi(targetDpi);
+    if (!previewQuads.empty()) {
+        cv::Rect2d area = unionArea(previewQuads, preview.size(), previewDpi, marginInches);
+        if (!area.empty()) {
+            // The quads are mapped through the area the device actually took
+            result.areaInches = scanner.setScanArea(area);
+        }
+    }
+
+    try {
+        if (cancel.isCancelled()) {
+            throw ScanCancelled();
+        }
+        result.image = scanner.scanImageStreamed({}, passProgress(0.25, 0.75), cancel);
+    } catch (...) {
+        scanner.clearScanArea();
+        throw;
+    }
+    scanner.clearScanArea();
+
+    if (result.image.empty()) {
+        return result;
+    }
+
+    // Map the preview quads into the delivered image. The scale is taken from the image itself,
+    // backends round the resolution and the area to what the device supports.
+    cv::Rect2d frame = result.areaInches.empty()
+                           ? cv::Rect2d(0.0, 0.0, static_cast<double>(preview.cols) / previewDpi, static_cast<double>(preview.rows) / previewDpi)
+                           : result.areaInches;
+    double scaleX = result.image.cols / frame.width;
+    double scaleY = result.image.rows / frame.height;
+
+    for (const auto &quad : previewQuads) {
+        std::vector<cv::Point> mapped;
+        for (const auto &point : quad) {
+            double x = ((point.x + 0.5) / previewDpi - frame.x) * scaleX - 0.5;
+            double y = ((point.y + 0.5) / previewDpi - frame.y) * scaleY - 0.5;
+            mapped.emplace_back(cvRound(x), cvRound(y));
+        }
+        result.quads.push_back(mapped);
+    }
+
+    qDebug() << "RegionScan:" << result.quads.size() << "photos, scanned" << result.image.cols << "x" << result.image.rows
+             << (result.areaInches.empty() ? "of the whole bed" : "of the photo area");
+    return result;
+}
+
+int RegionScan::previewDpiFor(const ScannerInterface::Capabilities &capabilities, int targetDpi) {
+    if (capabilities.resolutions.empty()) {
+        // A range, or nothing known about the device
+        int dpi = std::max(defaultPreviewDpi, capabilities.minDpi);
+        return dpi < targetDpi ? dpi : 0;
+    }
+
+    int best = 0;
+    for (int dpi : capabilities.resolutions) {
+        if (dpi <= 0 || dpi >= targetDpi) {
+            continue;
+        }
+        // Ties go to the higher resolution, which finds the edges more reliably
+        int distance = std::abs(dpi - defaultPreviewDpi);
+        int bestDistance = std::abs(best - defaultPreviewDpi);
+        if (best == 0 || distance < bestDistance || (distance == bestDistance && dpi > best)) {
+            best = dpi;
+        }
+    }
+    return best;
+}
+
+cv::Rect2d RegionScan::unionArea(const std::vector<std::vector<cv::Point>> &quads, const cv::Size &bedPixels,
+                                 int dpi, double marginInches) {
+    cv::Rect bounds;
+    for (const auto &quad : quads) {
+        bounds |= cv::boundingRect(quad);
+    }
+
+    cv::Rect2d area(static_cast<double>(bounds.x) / dpi - marginInches, static_cast<double>(bounds.y) / dpi - marginInches,
+                    static_cast<double>(bounds.width) / dpi + 2 * marginInches, static_cast<double>(bounds.height) / dpi + 2 * marginInches);
+    cv::Rect2d bed(0.0, 0.0, static_cast<double>(bedPixels.width) / dpi, static_cast<double>(bedPixels.height) / dpi);
+    return area & bed;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ScanProcessor.h"
+#include "ScannerInterface.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Two-pass acquisition: a fast low DPI preview of the whole bed finds the photos, then only the
+ * union of their bounding boxes is scanned at the target DPI.
+ */
+class RegionScan
+{
+public:
+    struct Result {
+        cv::Mat image;                              // Target DPI scan of the area
+        std::vector<std::vector<cv::Point>> quads;  // Photos found in the preview, in image coordinates
+        cv::Rect2d areaInches;                      // Empty when the whole bed had to be scanned
+        bool previewed = false;                     // False when no preview was made, image is then empty
+    };
+
+    static constexpr int defaultPreviewDpi = 75;
+
+    // The supported resolution below targetDpi closest to defaultPreviewDpi, 0 when there is none
+    static int previewDpiFor(const ScannerInterface::Capabilities &capabilities, int targetDpi);
+
+    // Leaves the scanner at targetDpi with its scan area cleared. Both passes stop when cancel is set and
+    // throw ScanCancelled, onProgress counts the preview as the first quarter. When the device rejects
+    // targetDpi or previewDpi nothing is scanned and previewed is false, scan the whole bed instead.
+    static Result scan(ScannerInterface &scanner, ScanProcessor &processor, int targetDpi, const ScanCancelToken &cancel,
+                       const ScannerInterface::ProgressCallback &onProgress = {},
+                       int previewDpi = defaultPreviewDpi, double marginInches = 0.1);
+
+    // Union of the quads' bounding boxes plus the margin, in inches and clipped to the bed
+    static cv::Rect2d unionArea(const std::vector<std::vector<cv::Point>> &quads, const cv::Size &bedPixels,
+                                int dpi, double marginInches);
+};
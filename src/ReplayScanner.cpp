@@ -0,0 +1,235 @@
+#include "ReplayScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+ReplayScanner::ReplayScanner(const Options &options)
+    : opts(options) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(opts.directory, error)) {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (entry.is_regular_file() &&
+            (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp" ||
+             extension == ".tif" || extension == ".tiff")) {
+            files.push_back(entry.path().string());
+        }
+    }
+    if (error) {
+        throw std::runtime_error("Cannot read replay directory " + opts.directory + ": " + error.message());
+    }
+
+    std::sort(files.begin(), files.end());
+    std::cout << "ReplayScanner: " << files.size() << " files in " << opts.directory << std::endl;
+}
+
+ReplayScanner::Options ReplayScanner::optionsFromEnvironment() {
+    Options options;
+    if (const char *directory = std::getenv("PICHASCAN_REPLAY_DIR")) {
+        options.directory = directory;
+    }
+    if (const char *dpi = std::getenv("PICHASCAN_REPLAY_DPI")) {
+        options.sourceDpi = std::max(1, std::atoi(dpi));
+    }
+    if (const char *latency = std::getenv("PICHASCAN_REPLAY_LINE_MS")) {
+        options.lineLatencyMs = std::max(0.0, std::atof(latency));
+    }
+    if (const char *bandwidth = std::getenv("PICHASCAN_REPLAY_BANDWIDTH")) {
+        options.bandwidthBytesPerSecond = std::max(0.0, std::atof(bandwidth));
+    }
+    return options;
+}
+
+bool ReplayScanner::isConfigured() {
+    const char *directory = std::getenv("PICHASCAN_REPLAY_DIR");
+    return directory && *directory;
+}
+
+std::wstring ReplayScanner::deviceName() const {
+    std::wstring directory(opts.directory.begin(), opts.directory.end());
+    return L"Replay: " + directory;
+}
+
+std::vector<std::wstring> ReplayScanner::getAvailableScanners() const {
+    return {deviceName()};
+}
+
+void ReplayScanner::setPreferredScanner(const std::wstring &scannerName) {
+    if (scannerName != deviceName()) {
+        throw std::runtime_error("Scanner not found");
+    }
+}
+
+void ReplayScanner::setDpi(int value) {
+    if (value <= 0) {
+        throw std::invalid_argument("Invalid DPI provided.");
+    }
+    dpi = value;
+}
+
+void ReplayScanner::setColorOption(int value) {
+    if (value < 1 || value > 3) {
+        throw std::invalid_argument("Invalid color option provided.");
+    }
+    colorOption = value;
+}
+
+cv::Rect2d ReplayScanner::setScanArea(const cv::Rect2d &areaInches) {
+    // Whole pixels of the source and clipped to it, like simulateDevice cuts them
+    const double sourceDpi = opts.sourceDpi;
+    cv::Rect area(cvRound(areaInches.x * sourceDpi), cvRound(areaInches.y * sourceDpi),
+                  cvRound(areaInches.width * sourceDpi), cvRound(areaInches.height * sourceDpi));
+    // Before the first sheet the bed is unknown, simulateDevice clips again against the file
+    area &= lastSourceSize.empty() ? cv::Rect(0, 0, INT_MAX, INT_MAX) : cv::Rect(cv::Point(0, 0), lastSourceSize);
+
+    scanArea = area.empty() ? cv::Rect2d()
+                            : cv::Rect2d(area.x / sourceDpi, area.y / sourceDpi, area.width / sourceDpi, area.height / sourceDpi);
+    return scanArea;
+}
+
+void ReplayScanner::clearScanArea() {
+    scanArea = cv::Rect2d();
+}
+
+cv::Mat ReplayScanner::scanImage() {
+    cv::Mat image = nextSheet();
+    simulateTransfer(image.rows, image.cols);
+    return image;
+}
+
+cv::Mat ReplayScanner::scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) {
+    cv::Mat image = nextSheet();
+
+    // The "device" sends bandRows lines at a time
+    constexpr int bandRows = 64;
+    for (int row = 0; row < image.rows; row += bandRows) {
+        if (cancel.isCancelled()) {
+            throw ScanCancelled();
+        }
+
+        cv::Mat band = image.rowRange(row, std::min(row + bandRows, image.rows));
+        simulateTransfer(band.rows, band.cols);
+        if (onBand) {
+            onBand(band, row, image.rows);
+        }
+        if (onProgress) {
+            onProgress(static_cast<double>(row + band.rows) / image.rows);
+        }
+    }
+    return image;
+}
+
+cv::Mat ReplayScanner::nextSheet() {
+    if (files.empty()) {
+        throw std::runtime_error("No files to replay in " + opts.directory);
+    }
+    if (nextFile >= files.size()) {
+        if (!opts.loop) {
+            throw std::runtime_error("All files have been replayed");
+        }
+        nextFile = 0;
+    }
+
+    const std::string &path = files[nextFile++];
+    cv::Mat source = cv::imread(path, cv::IMREAD_COLOR);
+    if (source.empty()) {
+        throw std::runtime_error("Failed to load " + path);
+    }
+    lastSourceSize = source.size();
+
+    cv::Mat image = simulateDevice(source);
+
+    std::cout << "ReplayScanner: replaying " << path << " (" << image.cols << "x" << image.rows << ")" << std::endl;
+    return image;
+}
+
+ScannerInterface::Capabilities ReplayScanner::queryCapabilities() {
+    // Files are resampled to any DPI, so no resolution limits, and every colour mode is simulated
+    Capabilities capabilities;
+    capabilities.colorOptions = {1, 2, 3};
+    capabilities.hasFeeder = true;
+    return capabilities;
+}
+
+bool ReplayScanner::setSource(Source source) {
+    feederSelected = source == Source::Feeder;
+    return true;
+}
+
+int ReplayScanner::scanBatch(const PageCallback &onPage, int maxPages) {
+    if (!feederSelected) {
+        maxPages = 1;
+    }
+    if (files.empty()) {
+        throw std::runtime_error("No files to replay in " + opts.directory);
+    }
+
+    // The feeder holds the files not replayed yet; once it is empty a looping replay refills it for the next batch
+    if (nextFile >= files.size() && opts.loop) {
+        nextFile = 0;
+    }
+
+    int pages = 0;
+    while ((maxPages == 0 || pages < maxPages) && nextFile < files.size()) {
+        pages++;
+        if (!onPage(scanImage())) {
+            break;
+        }
+    }
+    return pages;
+}
+
+cv::Mat ReplayScanner::simulateDevice(const cv::Mat &source) const {
+    cv::Mat image = source;
+
+    if (!scanArea.empty()) {
+        cv::Rect area(cvRound(scanArea.x * opts.sourceDpi), cvRound(scanArea.y * opts.sourceDpi),
+                      cvRound(scanArea.width * opts.sourceDpi), cvRound(scanArea.height * opts.sourceDpi));
+        area &= cv::Rect(0, 0, source.cols, source.rows);
+        if (area.empty()) {
+            throw std::runtime_error("Scan area is outside the bed");
+        }
+        image = source(area);
+    }
+
+    if (dpi > 0 && dpi != opts.sourceDpi) {
+        double scale = static_cast<double>(dpi) / opts.sourceDpi;
+        cv::resize(image, image, cv::Size(), scale, scale, scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    }
+
+    // The pipeline always works on BGR, like a WIA bitmap loaded with IMREAD_COLOR
+    if (colorOption == 2 || colorOption == 3) {
+        cv::Mat gray;
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        if (colorOption == 3) {
+            cv::threshold(gray, gray, 127, 255, cv::THRESH_BINARY);
+        }
+        cv::cvtColor(gray, image, cv::COLOR_GRAY2BGR);
+    }
+
+    return image;
+}
+
+void ReplayScanner::simulateTransfer(int rows, int cols) const {
+    // Each line is bound by the slower of head travel and transfer, the device sends 1 byte per
+    // pixel for grayscale and 1 bit for black and white
+    double lineBytes = cols * (colorOption == 1 ? 3.0 : colorOption == 2 ? 1.0 : 1.0 / 8.0);
+    double lineSeconds = opts.lineLatencyMs / 1000.0;
+    if (opts.bandwidthBytesPerSecond > 0.0) {
+        lineSeconds = std::max(lineSeconds, lineBytes / opts.bandwidthBytesPerSecond);
+    }
+    if (lineSeconds <= 0.0) {
+        return;
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(lineSeconds * rows));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ScannerInterface.h"
+
+#ifndef REPLAY_SCANNER_H
+#define REPLAY_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/**
+ * Virtual scanner that "scans" by replaying the image files of a directory in name order,
+ * for benchmarking and reproducing field issues without a physical device:
+ *  - DPI: files are resampled from Options::sourceDpi to the selected DPI
+ *  - scan area: the file is cropped to it, so a smaller area also transfers faster
+ *  - colour mode: grayscale and black and white are simulated from the file
+ *  - feeder: a batch replays the files that are left, one sheet per file
+ *  - streaming: bands of 64 lines, each delivered after its simulated transfer time
+ *  - timing: each line costs lineLatencyMs of head travel, or its transfer time at
+ *    bandwidthBytesPerSecond when that is slower
+ * Selected by createScanner when PICHASCAN_REPLAY_DIR is set, see optionsFromEnvironment().
+ */
+class ReplayScanner : public ScannerInterface {
+public:
+    struct Options {
+        std::string directory;
+        int sourceDpi = 600;                   // DPI the replayed files were scanned at
+        double lineLatencyMs = 0.0;            // Per output line, 0 for none
+        double bandwidthBytesPerSecond = 0.0;  // 0 for unlimited
+        bool loop = true;                      // Start over after the last file
+    };
+
+    explicit ReplayScanner(const Options &options);
+
+    // PICHASCAN_REPLAY_DIR, PICHASCAN_REPLAY_DPI, PICHASCAN_REPLAY_LINE_MS and PICHASCAN_REPLAY_BANDWIDTH
+    static Options optionsFromEnvironment();
+    static bool isConfigured();
+
+    std::vector<std::wstring> getAvailableScanners() const override;
+    void setPreferredScanner(const std::wstring& scannerName) override;
+    cv::Mat scanImage() override;
+    cv::Mat scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) override;
+    void setDpi(int dpi) override;
+    void setColorOption(int colorOption) override;
+    cv::Rect2d setScanArea(const cv::Rect2d &areaInches) override;
+    void clearScanArea() override;
+    Capabilities queryCapabilities() override;
+    bool setSource(Source source) override;
+    int scanBatch(const PageCallback &onPage, int maxPages = 0) override;
+
+private:
+    Options opts;
+    std::vector<std::string> files;
+    size_t nextFile = 0;
+    int dpi = 0;         // 0 keeps the source resolution
+    int colorOption = 1; // Same numbering as WiaScanner: 1 colour, 2 grayscale, 3 black and white
+    cv::Rect2d scanArea; // Inches, empty for the whole bed
+    cv::Size lastSourceSize; // Bed of the last sheet replayed, scan areas are clipped to it
+    bool feederSelected = false;
+
+    std::wstring deviceName() const;
+    // Loads the next file and applies the device settings to it
+    cv::Mat nextSheet();
+    cv::Mat simulateDevice(const cv::Mat &source) const;
+    // Sleeps for the time the device would take to send rows lines of cols pixels
+    void simulateTransfer(int rows, int cols) const;
+};
+
+#endif // REPLAY_SCANNER_H
@@ -0,0 +1,604 @@
+#ifdef __linux__
+
+#include "SaneScanner.h"
+
+#include <sane/saneopts.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <strings.h>
+
+// SANE is process wide and backends are not thread safe, yet scan sessions and scanner discovery
+// use their own SaneScanner next to the window's one on other threads. Every call into SANE holds
+// this lock; scans take it per sane_read, so the others get their turn between two chunks.
+static std::recursive_mutex saneMutex;
+using SaneLock = std::lock_guard<std::recursive_mutex>;
+static int saneUsers = 0;
+
+static void acquireSane() {
+    SaneLock lock(saneMutex);
+    if (saneUsers == 0) {
+        SANE_Int version = 0;
+        SANE_Status status = sane_init(&version, nullptr);
+        if (status != SANE_STATUS_GOOD) {
+            throw std::runtime_error(std::string("sane_init failed: ") + sane_strstatus(status));
+        }
+        std::cout << "SaneScanner: SANE " << SANE_VERSION_MAJOR(version) << "." << SANE_VERSION_MINOR(version)
+                  << "." << SANE_VERSION_BUILD(version) << std::endl;
+    }
+    saneUsers++;
+}
+
+static void releaseSane() {
+    SaneLock lock(saneMutex);
+    if (--saneUsers == 0) {
+        sane_exit();
+    }
+}
+
+SaneScanner::SaneScanner() {
+    acquireSane();
+
+    try {
+        populateAvailableScanners();
+    } catch (...) {
+        releaseSane();
+        throw;
+    }
+}
+
+SaneScanner::~SaneScanner() {
+    SaneLock lock(saneMutex);
+    if (handle) {
+        sane_close(handle);
+        handle = nullptr;
+    }
+    releaseSane();
+}
+
+void SaneScanner::throwOnError(SANE_Status status, const std::string &what) {
+    if (status != SANE_STATUS_GOOD) {
+        throw std::runtime_error(what + ": " + sane_strstatus(status));
+    }
+}
+
+void SaneScanner::populateAvailableScanners() {
+    SaneLock lock(saneMutex);
+    availableScanners.clear();
+
+    const SANE_Device **devices = nullptr;
+    throwOnError(sane_get_devices(&devices, SANE_FALSE), "Failed to enumerate SANE devices");
+
+    for (int i = 0; devices && devices[i]; i++) {
+        std::string name = devices[i]->name;
+        availableScanners.emplace_back(name.begin(), name.end());
+        std::cout << "Found scanner: " << name << " (" << devices[i]->vendor << " " << devices[i]->model << ")" << std::endl;
+    }
+
+    if (availableScanners.empty()) {
+        std::cerr << "populateAvailableScanners: No scanners found." << std::endl;
+    }
+}
+
+std::vector<std::wstring> SaneScanner::getAvailableScanners() const {
+    return availableScanners;
+}
+
+void SaneScanner::setPreferredScanner(const std::wstring &scannerName) {
+    SaneLock lock(saneMutex);
+    // SANE device names are plain ASCII, e.g. "genesys:libusb:001:004"
+    std::string name(scannerName.begin(), scannerName.end());
+
+    SANE_Handle device = nullptr;
+    throwOnError(sane_open(name.c_str(), &device), "Failed to open " + name);
+
+    if (handle) {
+        sane_close(handle);
+    }
+    handle = device;
+    feederSelected = false;
+}
+
+int SaneScanner::findOption(const char *name) const {
+    SaneLock lock(saneMutex);
+    if (!handle) {
+        throw std::runtime_error("No scanner selected");
+    }
+
+    // Option 0 always holds the number of options
+    SANE_Int count = 0;
+    if (sane_control_option(handle, 0, SANE_ACTION_GET_VALUE, &count, nullptr) != SANE_STATUS_GOOD) {
+        return -1;
+    }
+
+    for (SANE_Int i = 1; i < count; i++) {
+        const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, i);
+        if (descriptor && descriptor->name && std::strcmp(descriptor->name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void SaneScanner::setOptionValue(int option, void *value) {
+    SaneLock lock(saneMutex);
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    if (!descriptor || !SANE_OPTION_IS_ACTIVE(descriptor->cap) || !SANE_OPTION_IS_SETTABLE(descriptor->cap)) {
+        throw std::runtime_error(std::string("Option cannot be set: ") + (descriptor ? descriptor->name : "?"));
+    }
+
+    SANE_Int info = 0;
+    throwOnError(sane_control_option(handle, option, SANE_ACTION_SET_VALUE, value, &info),
+                 std::string("Failed to set ") + descriptor->name);
+}
+
+void SaneScanner::setDpi(int dpi) {
+    SaneLock lock(saneMutex);
+    int option = findOption(SANE_NAME_SCAN_RESOLUTION);
+    if (option < 0) {
+        throw std::runtime_error("Device has no resolution option.");
+    }
+
+    // Backends declare the resolution either as an integer or as a fixed point value
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    SANE_Word value = descriptor->type == SANE_TYPE_FIXED ? SANE_FIX(dpi) : dpi;
+    setOptionValue(option, &value);
+}
+
+double SaneScanner::currentDpi() const {
+    SaneLock lock(saneMutex);
+    int option = findOption(SANE_NAME_SCAN_RESOLUTION);
+    if (option < 0) {
+        throw std::runtime_error("Device has no resolution option.");
+    }
+
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    SANE_Word value = 0;
+    throwOnError(sane_control_option(handle, option, SANE_ACTION_GET_VALUE, &value, nullptr), "Failed to read resolution");
+    return descriptor->type == SANE_TYPE_FIXED ? SANE_UNFIX(value) : static_cast<double>(value);
+}
+
+cv::Rect2d SaneScanner::setScanArea(const cv::Rect2d &areaInches) {
+    SaneLock lock(saneMutex);
+    const char *names[4] = {SANE_NAME_SCAN_TL_X, SANE_NAME_SCAN_TL_Y, SANE_NAME_SCAN_BR_X, SANE_NAME_SCAN_BR_Y};
+    const double inches[4] = {areaInches.x, areaInches.y, areaInches.x + areaInches.width, areaInches.y + areaInches.height};
+
+    try {
+        int options[4];
+        for (int i = 0; i < 4; i++) {
+            options[i] = findOption(names[i]);
+            if (options[i] < 0) {
+                return cv::Rect2d();
+            }
+        }
+
+        // Start from the whole bed so no corner is clamped against the previous area
+        clearScanArea();
+        double actual[4];
+        for (int i = 0; i < 4; i++) {
+            setCoordinate(options[i], inches[i]);
+        }
+        // Read back once all four are set, setting one corner may move another
+        for (int i = 0; i < 4; i++) {
+            actual[i] = coordinate(options[i]);
+        }
+
+        cv::Rect2d area(actual[0], actual[1], actual[2] - actual[0], actual[3] - actual[1]);
+        if (area.width > 0 && area.height > 0) {
+            return area;
+        }
+        std::cerr << "setScanArea: the device reduced the area to nothing" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "setScanArea: " << e.what() << std::endl;
+    }
+
+    clearScanArea();
+    return cv::Rect2d();
+}
+
+void SaneScanner::clearScanArea() {
+    SaneLock lock(saneMutex);
+    if (!handle) {
+        return;
+    }
+
+    const char *names[4] = {SANE_NAME_SCAN_TL_X, SANE_NAME_SCAN_TL_Y, SANE_NAME_SCAN_BR_X, SANE_NAME_SCAN_BR_Y};
+    for (int i = 0; i < 4; i++) {
+        int option = findOption(names[i]);
+        const SANE_Option_Descriptor *descriptor = option < 0 ? nullptr : sane_get_option_descriptor(handle, option);
+        if (!descriptor || descriptor->constraint_type != SANE_CONSTRAINT_RANGE) {
+            continue;
+        }
+
+        // Top left to the range minimum, bottom right to the maximum
+        SANE_Word value = i < 2 ? descriptor->constraint.range->min : descriptor->constraint.range->max;
+        try {
+            setOptionValue(option, &value);
+        } catch (const std::exception &e) {
+            std::cerr << "clearScanArea: " << e.what() << std::endl;
+        }
+    }
+}
+
+void SaneScanner::setCoordinate(int option, double inches) {
+    SaneLock lock(saneMutex);
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    double value = descriptor->unit == SANE_UNIT_PIXEL ? inches * currentDpi() : inches * 25.4;
+
+    SANE_Word word = descriptor->type == SANE_TYPE_FIXED ? SANE_FIX(value) : static_cast<SANE_Word>(std::lround(value));
+    if (descriptor->constraint_type == SANE_CONSTRAINT_RANGE) {
+        word = std::clamp(word, descriptor->constraint.range->min, descriptor->constraint.range->max);
+    }
+    setOptionValue(option, &word);
+}
+
+double SaneScanner::coordinate(int option) const {
+    SaneLock lock(saneMutex);
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    SANE_Word word = 0;
+    throwOnError(sane_control_option(handle, option, SANE_ACTION_GET_VALUE, &word, nullptr),
+                 std::string("Failed to read ") + descriptor->name);
+
+    double value = descriptor->type == SANE_TYPE_FIXED ? SANE_UNFIX(word) : static_cast<double>(word);
+    return descriptor->unit == SANE_UNIT_PIXEL ? value / currentDpi() : value / 25.4;
+}
+
+ScannerInterface::Capabilities SaneScanner::queryCapabilities() {
+    SaneLock lock(saneMutex);
+    Capabilities capabilities;
+
+    int option = findOption(SANE_NAME_SCAN_RESOLUTION);
+    const SANE_Option_Descriptor *descriptor = option < 0 ? nullptr : sane_get_option_descriptor(handle, option);
+    if (descriptor) {
+        auto toDpi = [descriptor](SANE_Word word) {
+            return descriptor->type == SANE_TYPE_FIXED ? static_cast<int>(std::lround(SANE_UNFIX(word))) : static_cast<int>(word);
+        };
+
+        if (descriptor->constraint_type == SANE_CONSTRAINT_RANGE) {
+            capabilities.minDpi = toDpi(descriptor->constraint.range->min);
+            capabilities.maxDpi = toDpi(descriptor->constraint.range->max);
+        } else if (descriptor->constraint_type == SANE_CONSTRAINT_WORD_LIST) {
+            // The first word is the length of the list
+            const SANE_Word *list = descriptor->constraint.word_list;
+            for (SANE_Word i = 1; i <= list[0]; i++) {
+                capabilities.resolutions.push_back(toDpi(list[i]));
+            }
+        }
+    }
+
+    option = findOption(SANE_NAME_SCAN_MODE);
+    descriptor = option < 0 ? nullptr : sane_get_option_descriptor(handle, option);
+    if (descriptor && descriptor->constraint_type == SANE_CONSTRAINT_STRING_LIST) {
+        for (int colorOption = 1; colorOption <= 3; colorOption++) {
+            bool offered = false;
+            for (const auto &candidate : modeCandidates(colorOption)) {
+                for (const SANE_String_Const *mode = descriptor->constraint.string_list; *mode && !offered; mode++) {
+                    offered = strcasecmp(candidate.c_str(), *mode) == 0;
+                }
+            }
+            if (offered) {
+                capabilities.colorOptions.push_back(colorOption);
+            }
+        }
+    }
+
+    option = findOption(SANE_NAME_SCAN_SOURCE);
+    descriptor = option < 0 ? nullptr : sane_get_option_descriptor(handle, option);
+    if (descriptor && descriptor->constraint_type == SANE_CONSTRAINT_STRING_LIST) {
+        for (const SANE_String_Const *source = descriptor->constraint.string_list; *source; source++) {
+            capabilities.hasFeeder = capabilities.hasFeeder || isFeederSource(*source);
+        }
+    }
+
+    return capabilities;
+}
+
+std::vector<std::string> SaneScanner::modeCandidates(int colorOption) {
+    // Same numbering as WiaScanner: 1 colour, 2 grayscale, 3 black and white
+    switch (colorOption) {
+    case 1:
+        return {SANE_VALUE_SCAN_MODE_COLOR, "Colour"};
+    case 2:
+        return {SANE_VALUE_SCAN_MODE_GRAY, "Grey", "Grayscale"};
+    case 3:
+        return {SANE_VALUE_SCAN_MODE_LINEART, "Binary", "Black & White"};
+    default:
+        throw std::invalid_argument("Invalid color option provided.");
+    }
+}
+
+bool SaneScanner::isFeederSource(const std::string &sourceName) {
+    // Source names differ per backend: "ADF", "ADF Front", "Automatic Document Feeder"...
+    std::string lower = sourceName;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return lower.find("adf") != std::string::npos || lower.find("feeder") != std::string::npos ||
+           lower.find("automatic") != std::string::npos;
+}
+
+void SaneScanner::setColorOption(int colorOption) {
+    SaneLock lock(saneMutex);
+    std::vector<std::string> candidates = modeCandidates(colorOption);
+
+    int option = findOption(SANE_NAME_SCAN_MODE);
+    if (option < 0) {
+        throw std::runtime_error("Device has no scan mode option.");
+    }
+
+    // Mode names are not fully standardised, use the first one this backend offers
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    std::string mode = candidates.front();
+    if (descriptor->constraint_type == SANE_CONSTRAINT_STRING_LIST) {
+        bool found = false;
+        for (const auto &candidate : candidates) {
+            for (const SANE_String_Const *offered = descriptor->constraint.string_list; *offered && !found; offered++) {
+                if (strcasecmp(candidate.c_str(), *offered) == 0) {
+                    mode = *offered;
+                    found = true;
+                }
+            }
+        }
+        if (!found) {
+            throw std::runtime_error("Color option not supported by this scanner.");
+        }
+    }
+
+    std::vector<char> value(std::max<size_t>(descriptor->size, mode.size() + 1), '\0');
+    std::copy(mode.begin(), mode.end(), value.begin());
+    setOptionValue(option, value.data());
+}
+
+cv::Mat SaneScanner::scanImage() {
+    return scanImageStreamed({}, {}, ScanCancelToken());
+}
+
+cv::Mat SaneScanner::scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) {
+    if (!handle) {
+        throw std::runtime_error("No scanner selected");
+    }
+
+    cv::Mat image;
+    bool acquired = false;
+    try {
+        acquired = acquirePage(image, onBand, onProgress, &cancel);
+    } catch (...) {
+        // Also stops the head when the scan was cancelled
+        SaneLock lock(saneMutex);
+        sane_cancel(handle);
+        throw;
+    }
+
+    // Ends the scan cycle so the next sane_start begins a new image
+    {
+        SaneLock lock(saneMutex);
+        sane_cancel(handle);
+    }
+
+    if (!acquired) {
+        throw std::runtime_error("No document in the feeder");
+    }
+    return image;
+}
+
+int SaneScanner::scanBatch(const PageCallback &onPage, int maxPages) {
+    if (!handle) {
+        throw std::runtime_error("No scanner selected");
+    }
+
+    if (!feederSelected) {
+        maxPages = 1;
+    }
+
+    int pages = 0;
+    try {
+        cv::Mat page;
+        while ((maxPages == 0 || pages < maxPages) && acquirePage(page)) {
+            pages++;
+            if (!onPage(page)) {
+                break;
+            }
+        }
+    } catch (...) {
+        SaneLock lock(saneMutex);
+        sane_cancel(handle);
+        throw;
+    }
+
+    SaneLock lock(saneMutex);
+    sane_cancel(handle);
+    return pages;
+}
+
+bool SaneScanner::acquirePage(cv::Mat &image, const BandCallback &onBand, const ProgressCallback &onProgress,
+                              const ScanCancelToken *cancel) {
+    image.release();
+    std::vector<cv::Mat> separateChannels(3); // Three-pass scanners send red, green and blue frames
+    bool lastFrame = false;
+    bool firstFrame = true;
+    int frame = 0;
+
+    while (!lastFrame) {
+        SANE_Parameters parameters = {};
+        {
+            SaneLock lock(saneMutex);
+            SANE_Status status = sane_start(handle);
+            if (firstFrame && status == SANE_STATUS_NO_DOCS) {
+                return false;
+            }
+            throwOnError(status, "Failed to start scan");
+            throwOnError(sane_get_parameters(handle, &parameters), "Failed to read scan parameters");
+        }
+        firstFrame = false;
+        lastFrame = parameters.last_frame;
+
+        const bool singlePass = parameters.format == SANE_FRAME_RGB || parameters.format == SANE_FRAME_GRAY;
+        const int frames = singlePass ? 1 : 3;
+        int delivered = 0;
+
+        cv::Mat raw;
+        readFrame(parameters, raw, [&](int lines) {
+            if (onProgress && parameters.lines > 0) {
+                onProgress((frame + std::min(1.0, static_cast<double>(lines) / parameters.lines)) / frames);
+            }
+            if (!onBand || !singlePass || lines <= delivered) {
+                return;
+            }
+
+            // Decoded to a copy, the lines in raw are converted in place once the frame is complete
+            cv::Mat band;
+            cv::cvtColor(decodeFrame(parameters, raw.rowRange(delivered, lines)), band,
+                         parameters.format == SANE_FRAME_RGB ? cv::COLOR_RGB2BGR : cv::COLOR_GRAY2BGR);
+            onBand(band, delivered, parameters.lines);
+            delivered = lines;
+        }, cancel);
+        cv::Mat decoded = decodeFrame(parameters, raw);
+        frame++;
+
+        switch (parameters.format) {
+        case SANE_FRAME_RGB:
+            // Swapped in place, the frame is usually a view of the buffer sane_read filled
+            cv::cvtColor(decoded, decoded, cv::COLOR_RGB2BGR);
+            image = decoded;
+            break;
+        case SANE_FRAME_GRAY:
+            cv::cvtColor(decoded, image, cv::COLOR_GRAY2BGR);
+            break;
+        case SANE_FRAME_RED:
+            separateChannels[2] = decoded;
+            break;
+        case SANE_FRAME_GREEN:
+            separateChannels[1] = decoded;
+            break;
+        case SANE_FRAME_BLUE:
+            separateChannels[0] = decoded;
+            break;
+        default:
+            throw std::runtime_error("Unsupported SANE frame format");
+        }
+    }
+
+    if (image.empty() && !separateChannels[0].empty() && !separateChannels[1].empty() && !separateChannels[2].empty()) {
+        cv::merge(separateChannels, image);
+        if (onBand) {
+            onBand(image, 0, image.rows);
+        }
+    }
+
+    if (image.empty()) {
+        throw std::runtime_error("Failed to load scanned image");
+    }
+    return true;
+}
+
+bool SaneScanner::setSource(Source source) {
+    SaneLock lock(saneMutex);
+    int option = findOption(SANE_NAME_SCAN_SOURCE);
+    if (option < 0) {
+        return source == Source::Flatbed;
+    }
+
+    const SANE_Option_Descriptor *descriptor = sane_get_option_descriptor(handle, option);
+    if (descriptor->constraint_type != SANE_CONSTRAINT_STRING_LIST) {
+        return false;
+    }
+
+    for (const SANE_String_Const *offered = descriptor->constraint.string_list; *offered; offered++) {
+        std::string name = *offered;
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+        bool matches = source == Source::Feeder
+                           ? isFeederSource(name)
+                           : lower.find("flatbed") != std::string::npos || lower.find("normal") != std::string::npos;
+        if (matches) {
+            std::vector<char> value(std::max<size_t>(descriptor->size, name.size() + 1), '\0');
+            std::copy(name.begin(), name.end(), value.begin());
+            setOptionValue(option, value.data());
+            feederSelected = source == Source::Feeder;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SaneScanner::readFrame(const SANE_Parameters &parameters, cv::Mat &raw, const std::function<void(int lines)> &onLines,
+                            const ScanCancelToken *cancel) {
+    constexpr SANE_Int maxChunk = 1 << 20;
+    const int bytesPerLine = parameters.bytes_per_line;
+    if (bytesPerLine <= 0) {
+        throw std::runtime_error("Invalid SANE scan parameters");
+    }
+
+    // Hand scanners and some feeders report lines == -1
+    raw.create(parameters.lines > 0 ? parameters.lines : 1024, bytesPerLine, CV_8UC1);
+
+    size_t received = 0;
+    for (;;) {
+        if (received == raw.total()) {
+            cv::Mat grown(raw.rows * 2, bytesPerLine, CV_8UC1);
+            raw.copyTo(grown.rowRange(0, raw.rows));
+            raw = grown;
+        }
+
+        SANE_Int length = 0;
+        SANE_Int request = static_cast<SANE_Int>(std::min<size_t>(raw.total() - received, maxChunk));
+        SANE_Status status;
+        {
+            // Released between chunks, the callbacks below never run under the lock
+            SaneLock lock(saneMutex);
+            status = sane_read(handle, raw.data + received, request, &length);
+        }
+        if (status == SANE_STATUS_EOF) {
+            break;
+        }
+        throwOnError(status, "Failed to read scan data");
+        received += static_cast<size_t>(length);
+
+        if (onLines) {
+            onLines(static_cast<int>(received / bytesPerLine));
+        }
+        if (cancel && cancel->isCancelled()) {
+            throw ScanCancelled();
+        }
+    }
+
+    // Keep only the complete lines that arrived
+    raw = raw.rowRange(0, static_cast<int>(received / bytesPerLine));
+}
+
+cv::Mat SaneScanner::decodeFrame(const SANE_Parameters &parameters, const cv::Mat &raw) {
+    const int channels = parameters.format == SANE_FRAME_RGB ? 3 : 1;
+    const int samples = parameters.pixels_per_line * channels;
+
+    switch (parameters.depth) {
+    case 8:
+        // Lines may be padded past the last pixel
+        return raw.colRange(0, samples).reshape(channels);
+    case 16: {
+        // 16 bit samples come in host byte order
+        cv::Mat wide(raw.rows, parameters.pixels_per_line, CV_16UC(channels), raw.data, raw.step);
+        cv::Mat narrow;
+        wide.convertTo(narrow, CV_8U, 1.0 / 257.0);
+        return narrow;
+    }
+    case 1: {
+        // Most significant bit first, a set bit is black
+        cv::Mat unpacked(raw.rows, parameters.pixels_per_line, CV_8UC(channels));
+        for (int y = 0; y < raw.rows; y++) {
+            const uchar *source = raw.ptr<uchar>(y);
+            uchar *target = unpacked.ptr<uchar>(y);
+            for (int i = 0; i < samples; i++) {
+                target[i] = (source[i >> 3] & (0x80 >> (i & 7))) ? 0 : 255;
+            }
+        }
+        return unpacked;
+    }
+    default:
+        throw std::runtime_error("Unsupported bit depth: " + std::to_string(parameters.depth));
+    }
+}
+
+#endif // __linux__
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ScannerInterface.h"
+
+#ifndef SANE_SCANNER_H
+#define SANE_SCANNER_H
+
+#ifdef __linux__
+
+#include <sane/sane.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Instances may live on different threads, their SANE calls are serialized by one process wide lock.
+// A single instance is still only used from one thread at a time.
+class SaneScanner : public ScannerInterface {
+public:
+    SaneScanner();
+    ~SaneScanner() override;
+    std::vector<std::wstring> availableScanners;
+
+    std::vector<std::wstring> getAvailableScanners() const override;
+    void populateAvailableScanners();
+    // Accepts any SANE device name, also ones sane_get_devices does not list such as "test"
+    void setPreferredScanner(const std::wstring& scannerName) override;
+    cv::Mat scanImage() override;
+    // Single pass frames are decoded and delivered per sane_read chunk, three-pass frames once merged
+    cv::Mat scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) override;
+    void setDpi(int dpi) override;
+    void setColorOption(int colorOption) override;
+    // Reads the resolution, scan mode and source option descriptors of the open device
+    Capabilities queryCapabilities() override;
+    // Uses the standard tl-x/tl-y/br-x/br-y options, set the DPI first for backends that measure them in pixels.
+    // The options are read back, backends clamp and round them (SANE_INFO_INEXACT).
+    cv::Rect2d setScanArea(const cv::Rect2d &areaInches) override;
+    void clearScanArea() override;
+    // Picks the backend's ADF or flatbed entry of the standard source option
+    bool setSource(Source source) override;
+    // Keeps calling sane_start until the backend reports SANE_STATUS_NO_DOCS, with one sane_cancel at the end
+    int scanBatch(const PageCallback &onPage, int maxPages = 0) override;
+
+private:
+    SANE_Handle handle = nullptr;
+    bool feederSelected = false; // A flatbed would happily scan the same glass again on every sane_start
+
+    int findOption(const char *name) const;
+    void setOptionValue(int option, void *value);
+    void setCoordinate(int option, double inches);
+    double coordinate(int option) const; // Inches
+    double currentDpi() const;
+    // Scan mode names backends use for a colour option, mode names are not fully standardised
+    static std::vector<std::string> modeCandidates(int colorOption);
+    static bool isFeederSource(const std::string &sourceName);
+
+    // Reads every frame of one page, false when the feeder has no more documents. The caller ends the cycle with sane_cancel.
+    bool acquirePage(cv::Mat &image, const BandCallback &onBand = {}, const ProgressCallback &onProgress = {},
+                     const ScanCancelToken *cancel = nullptr);
+    // Reads one frame with sane_read straight into the rows of raw, which only has to grow
+    // when the backend does not know the number of lines up front
+    // onLines gets the number of complete lines after every chunk, cancel is checked between chunks
+    void readFrame(const SANE_Parameters &parameters, cv::Mat &raw, const std::function<void(int lines)> &onLines = {},
+                   const ScanCancelToken *cancel = nullptr);
+    // 8 bit samples in the frame's own channel order, a view into raw whenever the depth is 8
+    static cv::Mat decodeFrame(const SANE_Parameters &parameters, const cv::Mat &raw);
+    static void throwOnError(SANE_Status status, const std::string &what);
+};
+
+#endif // __linux__
+
+#endif // SANE_SCANNER_H
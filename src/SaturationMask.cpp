@@ -0,0 +1,50 @@
+#include "SaturationMask.h"
+#include "SaturationMask.simd.hpp"
+#include <algorithm>
+
+#ifdef PICHASCAN_SIMD_DISPATCH
+// Kernels built by the files in simd/ with wider instruction sets
+namespace SaturationMaskKernel {
+namespace opt_SSE4_1 {
+void computeRows(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, int threshold);
+}
+namespace opt_AVX2 {
+void computeRows(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, int threshold);
+}
+namespace opt_AVX512_SKX {
+void computeRows(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, int threshold);
+}
+} // namespace SaturationMaskKernel
+#endif
+
+using Kernel = void (*)(const uchar *, size_t, uchar *, size_t, int, int, int);
+
+static Kernel selectKernel() {
+#ifdef PICHASCAN_SIMD_DISPATCH
+    if (cv::checkHardwareSupport(CV_CPU_AVX512_SKX)) {
+        return SaturationMaskKernel::opt_AVX512_SKX::computeRows;
+    }
+    if (cv::checkHardwareSupport(CV_CPU_AVX2)) {
+        return SaturationMaskKernel::opt_AVX2::computeRows;
+    }
+    if (cv::checkHardwareSupport(CV_CPU_SSE4_1)) {
+        return SaturationMaskKernel::opt_SSE4_1::computeRows;
+    }
+#endif
+    return SaturationMaskKernel::cpu_baseline::computeRows;
+}
+
+void SaturationMask::compute(const cv::Mat &bgr, cv::Mat &mask, int threshold) {
+    CV_Assert(bgr.type() == CV_8UC3);
+
+    static const Kernel kernel = selectKernel();
+    threshold = std::clamp(threshold, 0, 255);
+
+    mask.create(bgr.size(), CV_8UC1);
+
+    // The kernel is memory bound, split the rows over OpenCV's thread pool
+    cv::parallel_for_(cv::Range(0, bgr.rows), [&](const cv::Range &range) {
+        kernel(bgr.ptr<uchar>(range.start), bgr.step, mask.ptr<uchar>(range.start), mask.step,
+               bgr.cols, range.end - range.start, threshold);
+    });
+}
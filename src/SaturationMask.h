@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+/**
+ * Binary mask of the pixels whose HSV saturation is above a threshold.
+ *
+ * OpenCV's 8-bit HSV conversion computes S = round(255 * (max - min) / max), so
+ * S > t holds exactly when 255 * (max - min) >= t * max + ceil(max / 2) and max > min.
+ * That needs only the BGR min/max, so the mask is produced in one pass over the
+ * image instead of a full HSV conversion, a split into three planes and a threshold.
+ */
+class SaturationMask
+{
+public:
+    // mask becomes CV_8UC1, 255 where saturation > threshold, 0 elsewhere; bgr must be CV_8UC3
+    static void compute(const cv::Mat &bgr, cv::Mat &mask, int threshold);
+
+    static bool isSaturated(int b, int g, int r, int threshold) {
+        int maxValue = std::max(b, std::max(g, r));
+        int diff = maxValue - std::min(b, std::min(g, r));
+        return diff > 0 && 255 * diff >= threshold * maxValue + (maxValue + 1) / 2;
+    }
+};
@@ -0,0 +1,69 @@
+// Saturation mask kernel, shared by the baseline build in SaturationMask.cpp and by the
+// per instruction set builds in simd/. Each build lands in its own namespace
+// (cpu_baseline, opt_SSE4_1, opt_AVX2, opt_AVX512_SKX) and picks the widest
+// universal intrinsics enabled for it.
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace SaturationMaskKernel {
+CV_CPU_OPTIMIZATION_NAMESPACE_BEGIN
+
+void computeRows(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, int threshold);
+
+#ifndef CV_CPU_OPTIMIZATION_DECLARATIONS_ONLY
+
+// Scalar version for the row tails. Kept local to the namespace (no std::max/min) so no
+// inline function compiled with a wider instruction set can leak into the other builds.
+static inline uchar saturatedPixel(const uchar *pixel, int threshold) {
+    int maxValue = pixel[0] > pixel[1] ? pixel[0] : pixel[1];
+    int minValue = pixel[0] < pixel[1] ? pixel[0] : pixel[1];
+    maxValue = pixel[2] > maxValue ? pixel[2] : maxValue;
+    minValue = pixel[2] < minValue ? pixel[2] : minValue;
+    int diff = maxValue - minValue;
+    return (diff > 0 && 255 * diff >= threshold * maxValue + (maxValue + 1) / 2) ? 255 : 0;
+}
+
+void computeRows(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, int threshold) {
+    using namespace cv;
+
+    for (int y = 0; y < height; y++, src += srcStep, dst += dstStep) {
+        int x = 0;
+#if CV_SIMD
+        const int lanes = v_uint8::nlanes;
+        const v_uint16 vThreshold = vx_setall_u16(static_cast<ushort>(threshold));
+        const v_uint16 v255 = vx_setall_u16(255);
+        const v_uint16 vOne = vx_setall_u16(1);
+        const v_uint8 vZero = vx_setzero_u8();
+
+        for (; x <= width - lanes; x += lanes) {
+            v_uint8 b, g, r;
+            v_load_deinterleave(src + 3 * x, b, g, r);
+
+            v_uint8 maxValue = v_max(b, v_max(g, r));
+            v_uint8 diff = maxValue - v_min(b, v_min(g, r));
+
+            v_uint16 maxLo, maxHi, diffLo, diffHi;
+            v_expand(maxValue, maxLo, maxHi);
+            v_expand(diff, diffLo, diffHi);
+
+            // 255 * diff >= threshold * max + (max + 1) / 2, every term fits in 16 bits
+            v_uint16 lhsLo = v_mul_wrap(diffLo, v255);
+            v_uint16 lhsHi = v_mul_wrap(diffHi, v255);
+            v_uint16 rhsLo = v_mul_wrap(maxLo, vThreshold) + ((maxLo + vOne) >> 1);
+            v_uint16 rhsHi = v_mul_wrap(maxHi, vThreshold) + ((maxHi + vOne) >> 1);
+
+            v_uint8 mask = v_pack(lhsLo >= rhsLo, lhsHi >= rhsHi) & (diff != vZero);
+            v_store(dst + x, mask);
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = saturatedPixel(src + 3 * x, threshold);
+        }
+    }
+}
+
+#endif // CV_CPU_OPTIMIZATION_DECLARATIONS_ONLY
+
+CV_CPU_OPTIMIZATION_NAMESPACE_END
+} // namespace SaturationMaskKernel
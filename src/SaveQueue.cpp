@@ -0,0 +1,131 @@
+#include "SaveQueue.h"
+#include "ImageSaver.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QtConcurrent>
+
+SaveQueue::SaveQueue(const ScanProcessor::Options &options, int encoderThreads, int maxEncodedInFlight, QObject *parent)
+    : QObject(parent), options(options), writeSlots(std::max(1, maxEncodedInFlight)) {
+    encoderPool.setMaxThreadCount(encoderThreads > 0 ? encoderThreads : QThread::idealThreadCount());
+    writerPool.setMaxThreadCount(1);
+}
+
+SaveQueue::~SaveQueue() {
+    // Photos already have their file names and counts reserved, never drop them
+    waitForDone();
+}
+
+void SaveQueue::enqueue(std::vector<Job> jobs, std::function<void()> onSaved) {
+    if (jobs.empty()) {
+        if (onSaved) {
+            onSaved();
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(countMutex);
+        total += static_cast<int>(jobs.size());
+    }
+
+    auto batch = std::make_shared<Batch>(durability, orientationMode, static_cast<int>(jobs.size()), std::move(onSaved));
+    for (auto &job : jobs) {
+        QtConcurrent::run(&encoderPool, [this, job = std::move(job), batch]() { encode(job, batch); });
+    }
+}
+
+void SaveQueue::enqueueWrite(std::function<void()> write) {
+    QtConcurrent::run(&writerPool, std::move(write));
+}
+
+void SaveQueue::waitForDone() {
+    // Encoders hand their result to the writer before they finish, so the writer is drained last
+    encoderPool.waitForDone();
+    writerPool.waitForDone();
+}
+
+void SaveQueue::encode(const Job &job, const std::shared_ptr<Batch> &batch) {
+    std::vector<uchar> jpeg;
+    bool encoded = false;
+    try {
+        int rotation = job.orientation == -1 ? 0 : job.orientation;
+        int exifOrientation = 1;
+        if (batch->orientationMode == OrientationMode::ExifTag && ImageSaver::exifOrientationFor(rotation) != 0) {
+            exifOrientation = ImageSaver::exifOrientationFor(rotation);
+            rotation = 0;
+        }
+
+        ScanProcessor processor(options);
+        cv::Mat photo = processor.cropImage(job.scan, job.quad, rotation);
+        encoded = ImageSaver::encodeJpeg(photo, job.dateTime, job.location, jpeg, exifOrientation);
+    } catch (const std::exception &e) {
+        qWarning() << "Failed to crop" << job.filePath << ":" << e.what();
+    }
+
+    if (!encoded) {
+        finishJob(job.filePath, false);
+        finishBatchJob(batch);
+        return;
+    }
+
+    // Blocks while the writer is maxEncodedInFlight photos behind
+    writeSlots.acquire();
+    QString filePath = job.filePath;
+    QtConcurrent::run(&writerPool, [this, filePath, jpeg = std::move(jpeg), batch]() {
+        bool written = batch->files.add(filePath, reinterpret_cast<const char *>(jpeg.data()), static_cast<qint64>(jpeg.size()));
+        writeSlots.release();
+
+        // Deferred files are reported once the batch has put them in place
+        if (!written || !batch->files.defersRename()) {
+            finishJob(filePath, written);
+        }
+        finishBatchJob(batch);
+    });
+}
+
+void SaveQueue::finishBatchJob(const std::shared_ptr<Batch> &batch) {
+    if (--batch->remaining > 0) {
+        return;
+    }
+
+    QStringList files = batch->files.pendingFiles();
+    QStringList failedFiles = batch->files.commit();
+    for (const auto &filePath : files) {
+        finishJob(filePath, !failedFiles.contains(filePath));
+    }
+
+    if (batch->onSaved) {
+        batch->onSaved();
+    }
+}
+
+void SaveQueue::finishJob(const QString &filePath, bool saved) {
+    if (saved) {
+        qDebug() << "Image saved to" << filePath;
+    } else {
+        qWarning() << "Failed to save image to" << filePath;
+        emit saveFailed(filePath);
+    }
+
+    int completedNow, totalNow, failedNow;
+    {
+        std::lock_guard<std::mutex> lock(countMutex);
+        completed++;
+        if (!saved) {
+            failed++;
+        }
+        completedNow = completed;
+        totalNow = total;
+        failedNow = failed;
+
+        if (completed == total) {
+            total = completed = failed = 0;
+        }
+    }
+
+    emit progress(completedNow, totalNow);
+    if (completedNow == totalNow) {
+        emit finished(completedNow - failedNow, failedNow);
+    }
+}
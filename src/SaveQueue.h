@@ -0,0 +1,88 @@
+#pragma once
+
+#include "AtomicFile.h"
+#include "ScanProcessor.h"
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Background pipeline that saves the photos of a sheet:
+ *  - encoder stage: up to encoderThreads photos are cropped and encoded to memory at once
+ *  - writer stage: a single thread writes the encoded files in the order they finish
+ * At most maxEncodedInFlight encoded photos wait for the writer, encoders block until there is room.
+ * The photos of one enqueue() call form an AtomicWriteBatch, with Durability::Batch they are
+ * synced once and renamed into place together when the last one is written.
+ * Signals are emitted from the worker threads, receivers on the GUI thread get them queued.
+ */
+class SaveQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum class OrientationMode {
+        Pixels, // Right-angle turns are applied to the pixels before encoding
+        ExifTag // The pixels stay as cropped from the scan and the turn is recorded in Exif.Image.Orientation
+    };
+
+    struct Job {
+        cv::Mat scan;                // Shared with the caller, the pixels are not copied
+        std::vector<cv::Point> quad;
+        int orientation;             // Clockwise degrees, -1 for none
+        QString filePath;            // Reserved by the caller, so numbering never depends on completion order
+        QString dateTime;
+        std::pair<double, double> location;
+    };
+
+    explicit SaveQueue(const ScanProcessor::Options &options, int encoderThreads = 0, int maxEncodedInFlight = 4, QObject *parent = nullptr);
+    ~SaveQueue();
+
+    // onSaved runs once every photo of the batch is saved or has failed, on whichever thread finished last
+    void enqueue(std::vector<Job> jobs, std::function<void()> onSaved = {});
+    // Runs write on the writer thread, in order with the photos handed to it, e.g. to store the project file
+    void enqueueWrite(std::function<void()> write);
+    void waitForDone();
+
+    // Both apply to batches enqueued afterwards
+    void setDurability(AtomicFile::Durability level) { durability = level; }
+    AtomicFile::Durability durabilityLevel() const { return durability; }
+    void setOrientationMode(OrientationMode mode) { orientationMode = mode; }
+
+signals:
+    // Counts cover everything enqueued since the queue was last idle
+    void progress(int completed, int total);
+    void saveFailed(const QString &filePath);
+    void finished(int saved, int failed);
+
+private:
+    const ScanProcessor::Options options;
+    QThreadPool encoderPool;
+    QThreadPool writerPool;
+    QSemaphore writeSlots;
+    AtomicFile::Durability durability = AtomicFile::Durability::Batch;
+    OrientationMode orientationMode = OrientationMode::Pixels;
+
+    struct Batch {
+        Batch(AtomicFile::Durability durability, OrientationMode orientationMode, int size, std::function<void()> onSaved)
+            : files(durability), orientationMode(orientationMode), remaining(size), onSaved(std::move(onSaved)) {}
+        AtomicWriteBatch files;
+        const OrientationMode orientationMode;
+        std::atomic<int> remaining;
+        std::function<void()> onSaved;
+    };
+
+    std::mutex countMutex;
+    int total = 0;
+    int completed = 0;
+    int failed = 0;
+
+    void encode(const Job &job, const std::shared_ptr<Batch> &batch);
+    void finishBatchJob(const std::shared_ptr<Batch> &batch);
+    void finishJob(const QString &filePath, bool saved);
+};
@@ -1,6 +1,34 @@
 #include "ScanProcessor.h"
+#include "SaturationMask.h"
 #include <algorithm>
-#include <qDebug>
+#include <cmath>
+#include <QDebug>
+
+RegionCrop::RegionCrop(const cv::Mat &source, const cv::Rect &rect)
+    : source(source), rect(rect & cv::Rect(0, 0, source.cols, source.rows)) {
+}
+
+cv::Mat RegionCrop::view() const {
+    if (!materialized.empty()) {
+        return materialized;
+    }
+    return empty() ? cv::Mat() : source(rect);
+}
+
+const cv::Mat &RegionCrop::mat() const {
+    materialize();
+    return materialized;
+}
+
+void RegionCrop::materialize() const {
+    if (materialized.empty() && !empty()) {
+        materialized = source(rect).clone();
+    }
+}
+
+ScanProcessor::ScanProcessor(const Options &options)
+    : opts(options) {
+}
 
 ScanResult ScanProcessor::detectAndCropPhotos(const cv::Mat &scannedImage) {
     ScanResult result;
@@ -9,25 +37,204 @@ ScanResult ScanProcessor::detectAndCropPhotos(const cv::Mat &scannedImage) {
     if (scannedImage.empty()) {
         return result;
     }
-    result.annotated = scannedImage.clone();
+
+    // The pyramid path samples BGR pixels directly, anything else goes through the full resolution path
+    std::vector<QuadFit> quads;
+    if (opts.detectionMode == DetectionMode::Pyramid && scannedImage.type() == CV_8UC3) {
+        quads = detectQuadsPyramid(scannedImage);
+    } else {
+        quads = detectQuadsFullResolution(scannedImage);
+    }
+
+    for (const auto &quad : quads) {
+        DetectedRegion region = makeRegion(scannedImage, quad);
+        result.overlay.push_back(region.corners);
+
+        // Add this region to the result
+        result.regions.push_back(std::move(region));
+    }
+
+    if (opts.resultMode == ResultMode::Eager) {
+        result.annotated = renderOverlay(scannedImage, result.overlay);
+    }
+
+    return result;
+}
+
+DetectedRegion ScanProcessor::makeRegion(const cv::Mat &scannedImage, const QuadFit &quad) const {
+    // Create a DetectedRegion struct
+    DetectedRegion region;
+
+    cv::RotatedRect rotRect = cv::minAreaRect(quad.corners);
+    cv::Point2f vertices[4];
+    rotRect.points(vertices);
+
+    std::vector<cv::Point> intCorners;
+    for (int i = 0; i < 4; ++i) {
+        intCorners.push_back(cv::Point(vertices[i])); // Implicit conversion to cv::Point
+    }
+
+    // Bounding box
+    cv::Rect boundingRect = cv::boundingRect(intCorners) & cv::Rect(0, 0, scannedImage.cols, scannedImage.rows);
+
+    region.corners = intCorners;
+    region.boundingBox = boundingRect;
+    region.cropped = RegionCrop(scannedImage, boundingRect);
+    region.fitError = quad.fitError;
+
+    if (opts.resultMode == ResultMode::Eager) {
+        region.cropped.materialize();
+    }
+    return region;
+}
+
+cv::Mat ScanProcessor::renderOverlay(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>> &overlay) {
+    cv::Mat annotated = scannedImage.clone();
+    for (const auto &polyline : overlay) {
+        for (size_t i = 0; i < polyline.size(); i++) {
+            line(annotated, polyline[i], polyline[(i + 1) % polyline.size()], cv::Scalar(0, 255, 0), 5, cv::LINE_AA);
+        }
+    }
+    return annotated;
+}
+
+std::vector<QuadFit> ScanProcessor::detectQuadsFullResolution(const cv::Mat &scannedImage) const {
+    // 1. Threshold the saturation channel
+    cv::Mat thresh;
+    saturationMask(scannedImage, thresh);
+
+    // 2. Find the quads in the mask
+    return findQuads(thresh);
+}
+
+std::vector<QuadFit> ScanProcessor::detectQuadsPyramid(const cv::Mat &scannedImage) const {
+    // 1. Build the downscaled proxy, INTER_AREA averages whole blocks of pixels
+    float scale = proxyScale();
+
+    cv::Mat proxy;
+    cv::resize(scannedImage, proxy, cv::Size(), 1.0 / scale, 1.0 / scale, cv::INTER_AREA);
+
+    // 2. Detect quads on the proxy
+    cv::Mat thresh;
+    saturationMask(proxy, thresh);
+    std::vector<QuadFit> quads = findQuads(thresh);
+
+    // 3. Map each quad back to the full resolution frame and refine its edges there
+    return refineProxyQuads(scannedImage, std::move(quads), scale);
+}
+
+std::vector<cv::Point2f> ScanProcessor::refineQuad(const cv::Mat &scannedImage, const std::vector<cv::Point2f> &corners, float searchRadius) const {
+    cv::Rect imageRect(0, 0, scannedImage.cols, scannedImage.rows);
+    int samples = std::max(opts.refineSamples, 2);
+    int radius = static_cast<int>(std::ceil(searchRadius));
+
+    // Fit a line to the photo boundary along each edge, only touching pixels on short normals to the edge
+    std::vector<cv::Vec4f> edges(4);
+    std::vector<bool> fitted(4, false);
+    for (int i = 0; i < 4; i++) {
+        cv::Point2f a = corners[i];
+        cv::Point2f b = corners[(i + 1) % 4];
+        float length = static_cast<float>(cv::norm(b - a));
+        if (length < 1.0f) {
+            continue;
+        }
+        cv::Point2f dir = (b - a) / length;
+        cv::Point2f normal(-dir.y, dir.x);
+
+        std::vector<cv::Point2f> boundary;
+        for (int k = 0; k < samples; k++) {
+            // Stay clear of the corners, they are often rounded or frayed
+            float t = length * (0.1f + 0.8f * k / (samples - 1));
+            cv::Point2f p = a + dir * t;
+
+            // Find the mask transition closest to the proxy edge
+            int previous = -1;
+            float bestOffset = 0;
+            bool found = false;
+            for (int s = -radius; s <= radius; s++) {
+                cv::Point q(cvRound(p.x + normal.x * s), cvRound(p.y + normal.y * s));
+                if (!imageRect.contains(q)) {
+                    previous = -1;
+                    continue;
+                }
+                int inside = isSaturated(scannedImage.at<cv::Vec3b>(q)) ? 1 : 0;
+                if (previous != -1 && inside != previous) {
+                    float offset = s - 0.5f;
+                    if (!found || std::abs(offset) < std::abs(bestOffset)) {
+                        bestOffset = offset;
+                        found = true;
+                    }
+                }
+                previous = inside;
+            }
+
+            if (found) {
+                boundary.push_back(p + normal * bestOffset);
+            }
+        }
+
+        if (boundary.size() >= 2) {
+            cv::fitLine(boundary, edges[i], cv::DIST_HUBER, 0, 0.01, 0.01);
+            fitted[i] = true;
+        }
+    }
+
+    // Each corner is the intersection of its two adjacent edges
+    std::vector<cv::Point2f> refined = corners;
+    for (int i = 0; i < 4; i++) {
+        int previousEdge = (i + 3) % 4;
+        if (!fitted[previousEdge] || !fitted[i]) {
+            continue;
+        }
+        const cv::Vec4f &l1 = edges[previousEdge];
+        const cv::Vec4f &l2 = edges[i];
+        float cross = l1[0] * l2[1] - l1[1] * l2[0];
+        if (std::abs(cross) < 1e-3f) {
+            continue;
+        }
+        float dx = l2[2] - l1[2];
+        float dy = l2[3] - l1[3];
+        float t = (dx * l2[1] - dy * l2[0]) / cross;
+        cv::Point2f intersection(l1[2] + t * l1[0], l1[3] + t * l1[1]);
+
+        // Reject intersections that wandered far from the proxy estimate
+        if (cv::norm(intersection - corners[i]) <= 4.0f * searchRadius) {
+            refined[i] = intersection;
+        }
+    }
+
+    return refined;
+}
+
+void ScanProcessor::saturationMask(const cv::Mat &image, cv::Mat &mask) {
+    // 8-bit BGR scans go through the fused kernel, no HSV image or channel planes are allocated
+    if (image.type() == CV_8UC3) {
+        SaturationMask::compute(image, mask, saturationThreshold);
+        return;
+    }
 
     // 1. Get saturation channel
     cv::Mat hsv;
-    cv::cvtColor(scannedImage, hsv, cv::COLOR_BGR2HSV);
+    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
     std::vector<cv::Mat> hsv_channels;
     cv::split(hsv, hsv_channels);         // Split the HSV image into its 3 channels
     cv::Mat saturation = hsv_channels[1]; // Get the second channel (saturation)
 
     // 2. Threshhold
-    cv::Mat thresh;
-    cv::threshold(saturation, thresh, 5, 255, cv::THRESH_BINARY);
+    cv::threshold(saturation, mask, saturationThreshold, 255, cv::THRESH_BINARY);
+}
 
+bool ScanProcessor::isSaturated(const cv::Vec3b &pixel) {
+    return SaturationMask::isSaturated(pixel[0], pixel[1], pixel[2], saturationThreshold);
+}
+
+std::vector<QuadFit> ScanProcessor::findQuads(const cv::Mat &mask) const {
     // 3. Find contours
     std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
     // 4. Filter for large areas
-    double imgArea = scannedImage.rows * scannedImage.cols;
+    double imgArea = mask.rows * mask.cols;
     std::vector<std::vector<cv::Point>> largeContours;
     for (const auto &contour : contours) {
         double contourArea = cv::contourArea(contour);
@@ -38,159 +245,246 @@ ScanResult ScanProcessor::detectAndCropPhotos(const cv::Mat &scannedImage) {
     }
 
     // 5. Approximate each contour and check if it's a quadrilateral
-
+    std::vector<QuadFit> quads;
     for (const auto &contour : largeContours) {
-        double perimeter = cv::arcLength(contour, true);
-
-        for (int eps = 500; eps > 0; eps--) {
-            std::vector<cv::Point> approx;
-            cv::approxPolyDP(contour, approx, 0.001 * eps * perimeter, true);
-
-            if (approx.size() > 3) {
-                // Create a DetectedRegion struct
-                DetectedRegion region;
-
-                // Bounding box
-                cv::Rect boundingRect = cv::boundingRect(approx);
-                cv::RotatedRect rotRect = cv::minAreaRect(approx);
-
-                region.boundingBox = boundingRect;
-                region.cropped = scannedImage(boundingRect).clone();
-
-                cv::Point2f vertices[4];
-                rotRect.points(vertices);
-
-                std::vector<cv::Point> intCorners;
-                for (int i = 0; i < 4; ++i) {
-                    intCorners.push_back(cv::Point(vertices[i])); // Implicit conversion to cv::Point
-                }
-
-                region.corners = intCorners;
+        QuadFit quad = fitContour(contour);
+        if (!quad.corners.empty()) {
+            quads.push_back(std::move(quad));
+        }
+    }
 
-                // Assuming intCorners is a std::vector<cv::Point> with integer points
-                for (int i = 0; i < 4; i++) {
-                    line(result.annotated, intCorners[i], intCorners[(i + 1) % 4], cv::Scalar(0, 255, 0), 5, cv::LINE_AA);
-                }
+    return quads;
+}
 
-                // for (int i = 0; i < 4; i++)
-                //     line(result.annotated, vertices[i], vertices[(i+1)%4], cv::Scalar(0,255,0), 5, cv::FILLED);
+QuadFit ScanProcessor::fitContour(const std::vector<cv::Point> &contour) const {
+    return (opts.quadFitMode == QuadFitMode::LinearSweep) ? QuadFitter::fitLinearSweep(contour) : QuadFitter::fit(contour);
+}
 
-                // Add this region to the result
-                result.regions.push_back(std::move(region));
-                break;
-            }
+std::vector<QuadFit> ScanProcessor::refineProxyQuads(const cv::Mat &scannedImage, std::vector<QuadFit> quads, float scale) const {
+    // Map each quad back to the full resolution frame and refine its edges there
+    for (auto &quad : quads) {
+        std::vector<cv::Point2f> corners;
+        for (const auto &point : quad.corners) {
+            corners.emplace_back((point.x + 0.5f) * scale - 0.5f, (point.y + 0.5f) * scale - 0.5f);
         }
-    }
 
-    return result;
+        // A proxy pixel covers scale x scale scan pixels, search a couple of them on either side
+        quad.corners = refineQuad(scannedImage, corners, refineRadius(scale));
+        quad.fitError *= scale;
+    }
+    return quads;
 }
 
 std::vector<cv::Mat> ScanProcessor::cropImages(const cv::Mat &scannedImage,
                                                const std::vector<std::vector<cv::Point>> &quads,
                                                int scannedRotation,
-                                               const std::vector<int> &rotations) {
-    std::vector<cv::Mat> croppedImages;
-
-    // rotate the image
-    cv::Mat rotatedImage;
-    cv::Mat rotationMatrix = cv::getRotationMatrix2D(cv::Point(scannedImage.cols / 2, scannedImage.rows / 2), -scannedRotation, 1);
-    cv::warpAffine(scannedImage, rotatedImage, rotationMatrix, scannedImage.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255)); // Fill border with white
-
-    // Add white padding to the image
-    cv::Mat paddedImage;
-    int padding = -findMostNegativeXY(quads) * 10;
-    int borderType = cv::BORDER_CONSTANT;
-    cv::copyMakeBorder(scannedImage, paddedImage, padding, padding, padding, padding,
-                       borderType, cv::Scalar(255, 255, 255));
+                                               const std::vector<int> &rotations) const {
+    // The per-photo rotations already include the scan orientation, scannedRotation is only
+    // kept for callers of the previous interface
+    (void)scannedRotation;
 
     if (quads.size() != rotations.size()) {
         throw std::invalid_argument("The size of 'quads' and 'rotations' must match.");
     }
 
-    for (size_t i = 0; i < quads.size(); ++i) {
-        const auto &quad = quads[i];
-        int rotationAngle = (rotations[i] == -1) ? 0 : rotations[i];
+    // Each region writes its own slot, so the output order does not depend on scheduling
+    std::vector<cv::Mat> croppedImages(quads.size());
+    auto cropRange = [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; ++i) {
+            int rotationAngle = (rotations[i] == -1) ? 0 : rotations[i];
+            croppedImages[i] = cropImage(scannedImage, quads[i], rotationAngle);
+        }
+    };
+
+    int regions = static_cast<int>(quads.size());
+    int workers = opts.maxCropThreads > 0 ? opts.maxCropThreads : cv::getNumThreads();
+    workers = std::min(workers, regions);
+
+    if (workers <= 1) {
+        cropRange(cv::Range(0, regions));
+    } else {
+        // One stripe per worker: OpenCV never runs more stripes at once than there are, which caps the concurrency
+        cv::parallel_for_(cv::Range(0, regions), cropRange, workers);
+    }
 
-        qDebug() << "cropImages: Rotation - " << rotationAngle;
+    return croppedImages;
+}
 
+cv::Mat ScanProcessor::cropImage(const cv::Mat &scannedImage, const std::vector<cv::Point> &quad, int rotationAngle) const {
+    // Find the rotated rectangle from the quad
+    cv::RotatedRect rotRect = cv::minAreaRect(quad);
+
+    // Transform from the scan to the upright crop, quads hanging off the scan sample the white border
+    cv::Rect cropBox;
+    cv::Mat transform = uprightCropTransform(rotRect, cropBox);
+    if (cropBox.empty()) {
+        return cv::Mat();
+    }
+    transform.at<double>(0, 2) -= cropBox.x;
+    transform.at<double>(1, 2) -= cropBox.y;
+    cv::Size outputSize = cropBox.size();
+
+    // Right angles (always the case for the scan and thumbnail orientations) are applied after the
+    // crop as an exact transpose/flip, so interpolation is only used for the residual skew
+    int rightAngle = ((rotationAngle % 360) + 360) % 360;
+    if (rightAngle % 90 == 0) {
         cv::Mat cropped;
-        // Translate quad points by the padding amount
-        std::vector<cv::Point> translatedQuad;
-        for (const auto &point : quad) {
-            translatedQuad.emplace_back(point.x + padding, point.y + padding);
+        if (!copyRightAngle(scannedImage, transform, outputSize, cropped)) {
+            cv::warpAffine(scannedImage, cropped, transform, outputSize,
+                           opts.cropInterpolation, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255)); // Fill border with white
         }
+        return rotateRightAngle(cropped, rightAngle);
+    }
 
-        // Find the rotated rectangle from the translated quad
-        cv::RotatedRect rotRect = cv::minAreaRect(translatedQuad);
+    // Compose the rotation of the cropped region into the same transform
+    {
+        // Define the center of rotation
+        cv::Point2f center(cropBox.width / 2.0f, cropBox.height / 2.0f);
 
-        cropped = cropRotatedRect(paddedImage, rotRect);
+        // Get the rotation matrix for the given angle
+        cv::Mat rotationMatrix = cv::getRotationMatrix2D(center, -rotationAngle, 1.0);
 
-        // Apply rotation to the cropped region
-        if (!cropped.empty() && rotationAngle != 0) {
-            // Define the center of rotation
-            cv::Point2f center(cropped.cols / 2.0f, cropped.rows / 2.0f);
+        // Compute the bounding box size of the rotated image
+        double absCos = std::abs(rotationMatrix.at<double>(0, 0));
+        double absSin = std::abs(rotationMatrix.at<double>(0, 1));
+        int newWidth = static_cast<int>(cropBox.height * absSin + cropBox.width * absCos);
+        int newHeight = static_cast<int>(cropBox.height * absCos + cropBox.width * absSin);
 
-            // Get the rotation matrix for the given angle
-            cv::Mat rotationMatrix = cv::getRotationMatrix2D(center, -rotationAngle, 1.0);
+        // Adjust the rotation matrix to account for translation
+        rotationMatrix.at<double>(0, 2) += (newWidth / 2.0 - center.x);
+        rotationMatrix.at<double>(1, 2) += (newHeight / 2.0 - center.y);
 
-            // Compute the bounding box size of the rotated image
-            double absCos = std::abs(rotationMatrix.at<double>(0, 0));
-            double absSin = std::abs(rotationMatrix.at<double>(0, 1));
-            int newWidth = static_cast<int>(cropped.rows * absSin + cropped.cols * absCos);
-            int newHeight = static_cast<int>(cropped.rows * absCos + cropped.cols * absSin);
+        transform = composeAffine(rotationMatrix, transform);
+        outputSize = cv::Size(newWidth, newHeight);
+    }
 
-            // Adjust the rotation matrix to account for translation
-            rotationMatrix.at<double>(0, 2) += (newWidth / 2.0 - center.x);
-            rotationMatrix.at<double>(1, 2) += (newHeight / 2.0 - center.y);
+    // One warp straight from the scan, sampling only the output pixels
+    cv::Mat cropped;
+    cv::warpAffine(scannedImage, cropped, transform, outputSize,
+                   opts.cropInterpolation, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255)); // Fill border with white
+    return cropped;
+}
 
-            // Create a new matrix to store the rotated image with updated size
-            cv::Mat rotatedCropped;
-            cv::warpAffine(cropped, rotatedCropped, rotationMatrix, cv::Size(newWidth, newHeight),
-                           cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255)); // Fill border with white
+cv::Mat ScanProcessor::rotateRightAngle(const cv::Mat &image, int clockwiseDegrees) {
+    if (image.empty()) {
+        return image;
+    }
+
+    // cv::rotate is a blocked transpose plus flip, no resampling
+    cv::Mat rotated;
+    switch (((clockwiseDegrees % 360) + 360) % 360) {
+    case 90:
+        cv::rotate(image, rotated, cv::ROTATE_90_CLOCKWISE);
+        return rotated;
+    case 180:
+        cv::rotate(image, rotated, cv::ROTATE_180);
+        return rotated;
+    case 270:
+        cv::rotate(image, rotated, cv::ROTATE_90_COUNTERCLOCKWISE);
+        return rotated;
+    default:
+        return image;
+    }
+}
 
-            // Update cropped with the rotated version
-            cropped = rotatedCropped;
+bool ScanProcessor::copyRightAngle(const cv::Mat &image, const cv::Mat &transform, cv::Size outputSize, cv::Mat &output) {
+    // Only applies when the transform is a whole-pixel translation combined with a multiple of 90 degrees
+    constexpr double tolerance = 1e-6;
+    int m[2][3];
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 3; c++) {
+            double value = transform.at<double>(r, c);
+            m[r][c] = cvRound(value);
+            if (std::abs(value - m[r][c]) > tolerance) {
+                return false;
+            }
         }
+    }
 
-        croppedImages.push_back(cropped);
+    int clockwise;
+    if (m[0][0] == 1 && m[0][1] == 0 && m[1][0] == 0 && m[1][1] == 1) {
+        clockwise = 0;
+    } else if (m[0][0] == 0 && m[0][1] == -1 && m[1][0] == 1 && m[1][1] == 0) {
+        clockwise = 90;
+    } else if (m[0][0] == -1 && m[0][1] == 0 && m[1][0] == 0 && m[1][1] == -1) {
+        clockwise = 180;
+    } else if (m[0][0] == 0 && m[0][1] == 1 && m[1][0] == -1 && m[1][1] == 0) {
+        clockwise = 270;
+    } else {
+        return false;
     }
 
-    return croppedImages;
+    // Map the output corners back into the scan to find the source rectangle
+    cv::Mat inverse;
+    cv::invertAffineTransform(transform, inverse);
+    std::vector<cv::Point2d> outputCorners = {
+        {0.0, 0.0}, {outputSize.width - 1.0, outputSize.height - 1.0}};
+    std::vector<cv::Point2d> sourceCorners;
+    cv::transform(outputCorners, sourceCorners, inverse);
+
+    int x0 = cvRound(std::min(sourceCorners[0].x, sourceCorners[1].x));
+    int y0 = cvRound(std::min(sourceCorners[0].y, sourceCorners[1].y));
+    int x1 = cvRound(std::max(sourceCorners[0].x, sourceCorners[1].x)) + 1;
+    int y1 = cvRound(std::max(sourceCorners[0].y, sourceCorners[1].y)) + 1;
+    cv::Rect sourceRect(x0, y0, x1 - x0, y1 - y0);
+
+    // Copy the part inside the scan, fill the rest white like the warp's border would
+    cv::Rect inside = sourceRect & cv::Rect(0, 0, image.cols, image.rows);
+    cv::Mat source;
+    if (inside.empty()) {
+        source = cv::Mat(sourceRect.size(), image.type(), cv::Scalar(255, 255, 255));
+    } else {
+        cv::copyMakeBorder(image(inside), source,
+                           inside.y - sourceRect.y, sourceRect.br().y - inside.br().y,
+                           inside.x - sourceRect.x, sourceRect.br().x - inside.br().x,
+                           cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+    }
+
+    output = rotateRightAngle(source, clockwise);
+    return true;
 }
 
-double ScanProcessor::findMostNegativeXY(const std::vector<std::vector<cv::Point>> &quads) {
-    double mostNegative = std::numeric_limits<double>::max();
+cv::Mat ScanProcessor::cropRotatedRect(const cv::Mat &image, const cv::RotatedRect &rotRect) {
+    cv::Rect uprightBoundingBox;
+    cv::Mat rotationMatrix = uprightCropTransform(rotRect, uprightBoundingBox);
 
-    for (const auto &quad : quads) {
-        for (const auto &point : quad) {
-            mostNegative = std::min({mostNegative, static_cast<double>(point.x), static_cast<double>(point.y)});
-        }
+    // Same clipping as cropping a rotation of the entire image
+    cv::Rect cropBox = uprightBoundingBox & cv::Rect(0, 0, image.cols, image.rows);
+    if (cropBox.empty()) {
+        return cv::Mat();
     }
 
-    qDebug() << "Most negative: " << mostNegative;
-    if (mostNegative > 0) {
-        return -10;
-    }
+    // Only warp the upright rectangle: shift the rotation so the crop box lands at the origin,
+    // warpAffine then maps each destination pixel back through the inverse transform
+    rotationMatrix.at<double>(0, 2) -= cropBox.x;
+    rotationMatrix.at<double>(1, 2) -= cropBox.y;
 
-    return mostNegative;
+    cv::Mat cropped;
+    cv::warpAffine(image, cropped, rotationMatrix, cropBox.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    return cropped;
 }
 
-cv::Mat ScanProcessor::cropRotatedRect(const cv::Mat &image, const cv::RotatedRect &rotRect) {
+cv::Mat ScanProcessor::uprightCropTransform(const cv::RotatedRect &rotRect, cv::Rect &uprightBoundingBox) {
     // Get the rotation matrix for the `RotatedRect`
     cv::Mat rotationMatrix = cv::getRotationMatrix2D(rotRect.center, rotRect.angle, 1.0);
 
-    // Rotate the entire image
-    cv::Mat rotatedImage;
-    cv::warpAffine(image, rotatedImage, rotationMatrix, image.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
-
     cv::Size rectSize = rotRect.size;
     if (rotRect.angle < -45.0) { // Adjust width/height if needed
         std::swap(rectSize.width, rectSize.height);
     }
-    cv::Rect uprightBoundingBox(cv::Point(rotRect.center.x - rectSize.width / 2,
-                                          rotRect.center.y - rectSize.height / 2),
-                                rectSize);
+    uprightBoundingBox = cv::Rect(cv::Point(rotRect.center.x - rectSize.width / 2,
+                                            rotRect.center.y - rectSize.height / 2),
+                                  rectSize);
 
-    // Crop the upright rectangle
-    return rotatedImage(uprightBoundingBox & cv::Rect(0, 0, rotatedImage.cols, rotatedImage.rows)).clone();
-}
\ No newline at end of file
+    return rotationMatrix;
+}
+
+cv::Mat ScanProcessor::composeAffine(const cv::Mat &second, const cv::Mat &first) {
+    // Apply `first`, then `second`, as one 2x3 matrix
+    cv::Mat a = cv::Mat::eye(3, 3, CV_64F);
+    cv::Mat b = cv::Mat::eye(3, 3, CV_64F);
+    second.copyTo(a.rowRange(0, 2));
+    first.copyTo(b.rowRange(0, 2));
+    cv::Mat composed = a * b;
+    return composed.rowRange(0, 2).clone();
+}
@@ -1,43 +1,135 @@
 #pragma once
 
+#include "QuadFitter.h"
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+/**
+ * A crop of the scanned image that shares the scan's pixels until it is needed on its own:
+ *  - view(): an ROI header into the scan, nothing is copied
+ *  - mat(): a deep copy, made on first access and kept afterwards
+ * Not thread safe, materialize on one thread before sharing.
+ */
+class RegionCrop
+{
+public:
+    RegionCrop() = default;
+    RegionCrop(const cv::Mat &source, const cv::Rect &rect);
+
+    cv::Mat view() const;
+    const cv::Mat &mat() const;
+    void materialize() const;
+
+    bool empty() const { return rect.empty(); }
+    bool isMaterialized() const { return !materialized.empty(); }
+
+private:
+    cv::Mat source;
+    cv::Rect rect;
+    mutable cv::Mat materialized;
+};
+
 /**
  * Represents a single detected photo region:
  *  - The 4 corner points (approx polygon)
  *  - A bounding box
- *  - The cropped Mat itself
+ *  - The cropped image, lazily copied out of the scan
  */
 struct DetectedRegion
 {
     std::vector<cv::Point> corners;  // 4 corner points (clockwise or counterclockwise)
     cv::Rect boundingBox;            // The bounding rectangle
-    cv::Mat cropped;                 // The cropped image data
+    RegionCrop cropped;              // The cropped image data
+    double fitError = 0.0;           // Mean distance in pixels between the photo outline and the quad
 };
 
 /**
  * The result of running the detectAndCrop process:
- *  - annotated: a copy of the original scanned image with rectangles drawn
+ *  - annotated: a copy of the original scanned image with rectangles drawn, only in Eager mode
+ *  - overlay: the outlines that would be drawn, as polylines in scan coordinates
  *  - regions: a list of detected regions
  */
 struct ScanResult
 {
     cv::Mat annotated;
+    std::vector<std::vector<cv::Point>> overlay;
     std::vector<DetectedRegion> regions;
 };
 
 class ScanProcessor
 {
 public:
+    enum class QuadFitMode {
+        CoarseSweep, // QuadFitter::fit
+        LinearSweep  // QuadFitter::fitLinearSweep, the original 500-step epsilon loop
+    };
+
+    enum class DetectionMode {
+        FullResolution, // Threshold and find contours on the whole scan
+        Pyramid         // Find contours on a downscaled proxy, refine edges at full resolution
+    };
+
+    enum class ResultMode {
+        Eager, // Copy every crop and draw the outlines on a full copy of the scan
+        Lazy   // Crops are views into the scan, outlines are only returned as ScanResult::overlay
+    };
+
+    struct Options {
+        ResultMode resultMode = ResultMode::Eager;
+        DetectionMode detectionMode = DetectionMode::FullResolution;
+        int pyramidLevels = 2;     // Proxy is 1 / 2^pyramidLevels of the scan (2 -> 1/4, 3 -> 1/8)
+        int refineSamples = 48;    // Samples taken along each edge when refining at full resolution
+        QuadFitMode quadFitMode = QuadFitMode::CoarseSweep;
+        int maxCropThreads = 0;    // Regions cropped concurrently by cropImages, 0 uses OpenCV's thread count
+        int cropInterpolation = cv::INTER_LINEAR; // Used for the skew of each crop
+    };
+
     ScanProcessor() = default;
+    explicit ScanProcessor(const Options &options);
+
+    const Options &options() const { return opts; }
 
     // Returns each cropped photo as an individual Mat
     ScanResult detectAndCropPhotos(const cv::Mat& scannedImage);
-    std::vector<cv::Mat> cropImages(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>>& quads, int scannedRotation, const std::vector<int>& rotations);
+    // Regions are cropped in parallel (see Options::maxCropThreads), the result keeps the order of quads.
+    // Holds no shared state, so it can be called from any thread.
+    std::vector<cv::Mat> cropImages(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>>& quads, int scannedRotation, const std::vector<int>& rotations) const;
+
+    // Draws the overlay polylines on a copy of the scan, for callers that need the annotated image
+    static cv::Mat renderOverlay(const cv::Mat &scannedImage, const std::vector<std::vector<cv::Point>> &overlay);
+
+    // Crops one quad straight out of the scan with a single warp, rotated by rotationAngle degrees
+    cv::Mat cropImage(const cv::Mat &scannedImage, const std::vector<cv::Point> &quad, int rotationAngle) const;
 
-    static double findMostNegativeXY(const std::vector<std::vector<cv::Point>> &quads);
     static cv::Mat cropRotatedRect(const cv::Mat& image, const cv::RotatedRect& rotRect);
-};
 
+    // Saturation threshold separating photos from the (white) scanner lid
+    static constexpr int saturationThreshold = 5;
+
+private:
+    friend class StreamingDetector;
 
+    Options opts;
+
+    // Scan pixels per proxy pixel in Pyramid mode
+    float proxyScale() const { return static_cast<float>(1 << std::clamp(opts.pyramidLevels, 0, 5)); }
+    // A proxy pixel covers scale x scale scan pixels, refinement searches a couple of them on either side
+    static float refineRadius(float scale) { return 2.0f * scale + 2.0f; }
+
+    std::vector<QuadFit> detectQuadsFullResolution(const cv::Mat &scannedImage) const;
+    std::vector<QuadFit> detectQuadsPyramid(const cv::Mat &scannedImage) const;
+    std::vector<QuadFit> refineProxyQuads(const cv::Mat &scannedImage, std::vector<QuadFit> quads, float scale) const;
+    std::vector<cv::Point2f> refineQuad(const cv::Mat &scannedImage, const std::vector<cv::Point2f> &corners, float searchRadius) const;
+
+    static cv::Mat uprightCropTransform(const cv::RotatedRect &rotRect, cv::Rect &uprightBoundingBox);
+    static cv::Mat composeAffine(const cv::Mat &second, const cv::Mat &first);
+    static cv::Mat rotateRightAngle(const cv::Mat &image, int clockwiseDegrees);
+    static bool copyRightAngle(const cv::Mat &image, const cv::Mat &transform, cv::Size outputSize, cv::Mat &output);
+
+    static void saturationMask(const cv::Mat &image, cv::Mat &mask);
+    static bool isSaturated(const cv::Vec3b &pixel);
+    std::vector<QuadFit> findQuads(const cv::Mat &mask) const;
+    QuadFit fitContour(const std::vector<cv::Point> &contour) const;
+    DetectedRegion makeRegion(const cv::Mat &scannedImage, const QuadFit &quad) const;
+};
@@ -0,0 +1,26 @@
+#include "ScanPyramid.h"
+
+ScanPyramid::ScanPyramid(const cv::Mat &image)
+    : base(image), levels{image} {
+}
+
+cv::Mat ScanPyramid::level(int level) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while (static_cast<int>(levels.size()) <= level) {
+        cv::Mat next;
+        cv::resize(levels.back(), next, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+        levels.push_back(next);
+    }
+
+    return levels[level];
+}
+
+cv::Size ScanPyramid::levelSize(int level) const {
+    // Same rounding as cv::resize with a 0.5 scale factor
+    cv::Size size = base.size();
+    for (int i = 0; i < level; i++) {
+        size = cv::Size(cvRound(size.width * 0.5), cvRound(size.height * 0.5));
+    }
+    return size;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Resolution pyramid of a scan: level 0 is the scan itself and every level halves
+ * the previous one with INTER_AREA. Levels are built the first time they are asked
+ * for and kept; the class can be shared between the GUI and worker threads.
+ */
+class ScanPyramid
+{
+public:
+    explicit ScanPyramid(const cv::Mat &image);
+
+    cv::Mat level(int level);
+    cv::Size levelSize(int level) const;
+
+    const cv::Mat &image() const { return base; }
+
+private:
+    const cv::Mat base;
+    std::mutex mutex;
+    std::vector<cv::Mat> levels;
+};
@@ -0,0 +1,156 @@
+#include "ScanSession.h"
+
+#include <QDebug>
+#include <QtConcurrent>
+
+ScanSession::ScanSession(ScannerFactory scannerFactory, const ScanProcessor::Options &options, int queueDepth, QObject *parent)
+    : QObject(parent), scannerFactory(std::move(scannerFactory)), options(options), queueDepth(std::max(1, queueDepth)),
+      saveSlots(this->queueDepth) {
+    // One thread for the scan stage and one for the detect stage
+    stagePool.setMaxThreadCount(2);
+}
+
+ScanSession::~ScanSession() {
+    // Nobody will save the remaining sheets, so the detect stage must not wait for them
+    abandoned = true;
+    stopping = true;
+    if (scannedSheets) {
+        scannedSheets->close();
+    }
+    stagePool.waitForDone();
+}
+
+void ScanSession::start(int maxSheets, bool fromFeeder) {
+    if (running) {
+        return;
+    }
+
+    stopping = false;
+    running = true;
+    // A click from a previous session does not count
+    sheetRequests.tryAcquire(sheetRequests.available());
+    scannedSheets = std::make_unique<BoundedQueue<Sheet>>(queueDepth);
+
+    QtConcurrent::run(&stagePool, [this, maxSheets, fromFeeder]() { scanStage(maxSheets, fromFeeder); });
+    QtConcurrent::run(&stagePool, [this]() { detectStage(); });
+}
+
+void ScanSession::stop() {
+    stopping = true;
+}
+
+void ScanSession::sheetSaved() {
+    if (saveSlots.available() < queueDepth) {
+        saveSlots.release();
+    }
+}
+
+void ScanSession::nextSheet() {
+    // Clicks while the scanner is still busy count once
+    if (sheetRequests.available() == 0) {
+        sheetRequests.release();
+    }
+}
+
+bool ScanSession::waitForNextSheet(int index) {
+    post([this, index]() { emit sheetRequested(index); });
+
+    bool requested = false;
+    while (!requested && !stopping) {
+        requested = sheetRequests.tryAcquire(1, 100);
+    }
+    return requested;
+}
+
+void ScanSession::post(std::function<void()> function) {
+    QMetaObject::invokeMethod(this, std::move(function), Qt::QueuedConnection);
+}
+
+void ScanSession::scanStage(int maxSheets, bool fromFeeder) {
+    int index = 0;
+    try {
+        // Created, used and destroyed on this thread
+        std::unique_ptr<ScannerInterface> scanner = scannerFactory();
+        if (!scanner) {
+            throw std::runtime_error("No suitable scanner backend found!");
+        }
+
+        if (fromFeeder) {
+            // The device session stays open between sheets, each one is detected while the next is fed
+            scanner->scanBatch([this, &index](const cv::Mat &page) {
+                if (page.empty()) {
+                    throw std::runtime_error("No image returned.");
+                }
+                Sheet sheet;
+                sheet.index = index++;
+                sheet.image = page;
+                return pushSheet(std::move(sheet)) && !stopping;
+            }, maxSheets);
+        }
+
+        while (!fromFeeder && !stopping && (maxSheets == 0 || index < maxSheets)) {
+            if (index > 0 && !waitForNextSheet(index)) {
+                break;
+            }
+
+            Sheet sheet;
+            sheet.index = index;
+            sheet.image = scanner->scanImage();
+            if (sheet.image.empty()) {
+                throw std::runtime_error("No image returned.");
+            }
+            index++;
+
+            if (!pushSheet(std::move(sheet))) {
+                break;
+            }
+        }
+    } catch (const std::exception &e) {
+        QString message = QString::fromStdString(e.what());
+        post([this, message]() { emit failed(message); });
+    }
+
+    // The detect stage drains what was scanned and then ends the session
+    scannedSheets->close();
+}
+
+bool ScanSession::pushSheet(Sheet sheet) {
+    post([this, scanned = sheet.index]() { emit sheetScanned(scanned); });
+
+    // Blocks while the detect stage is queueDepth sheets behind
+    return scannedSheets->push(std::move(sheet));
+}
+
+void ScanSession::detectStage() {
+    ScanProcessor processor(options);
+    int delivered = 0;
+
+    Sheet sheet;
+    while (scannedSheets->pop(sheet)) {
+        try {
+            for (const auto &region : processor.detectAndCropPhotos(sheet.image).regions) {
+                sheet.quads.push_back(region.corners);
+            }
+        } catch (const std::exception &e) {
+            qWarning() << "ScanSession: detection failed on sheet" << sheet.index << ":" << e.what();
+        }
+
+        // Blocks while the save stage is queueDepth sheets behind
+        bool acquired = false;
+        while (!acquired && !abandoned) {
+            acquired = saveSlots.tryAcquire(1, 100);
+        }
+        if (!acquired) {
+            break;
+        }
+
+        delivered++;
+        post([this, sheet]() { emit sheetReady(sheet); });
+        sheet = Sheet();
+    }
+
+    post([this, delivered]() {
+        running = false;
+        emit finished(delivered);
+    });
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "BoundedQueue.h"
+#include "ScanProcessor.h"
+#include "ScannerInterface.h"
+#include <QObject>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Pipelined scanning: the scanner acquires sheet N+1 while sheet N is being detected and the
+ * photos of sheet N-1 are being saved.
+ *  - scan stage: its own thread, which also creates the scanner so COM based backends stay in
+ *    the apartment they were created in
+ *  - detect stage: runs detectAndCropPhotos and hands the sheet to the GUI thread (sheetReady)
+ *  - save stage: whatever the receiver does with the sheet, it calls sheetSaved() when done
+ * Stages are connected by bounded queues, at most queueDepth sheets wait between two stages.
+ * With a document feeder the scan stage runs one scanBatch and the session ends when the feeder is empty.
+ * On the flatbed the first sheet is scanned right away, every later one waits for nextSheet() so the
+ * operator can swap the sheet on the glass; sheetRequested says when the scanner is ready for it.
+ */
+class ScanSession : public QObject
+{
+    Q_OBJECT
+public:
+    using ScannerFactory = std::function<std::unique_ptr<ScannerInterface>()>;
+
+    struct Sheet {
+        int index = 0;
+        cv::Mat image;
+        std::vector<std::vector<cv::Point>> quads;
+    };
+
+    ScanSession(ScannerFactory scannerFactory, const ScanProcessor::Options &options, int queueDepth = 2, QObject *parent = nullptr);
+    ~ScanSession();
+
+    // maxSheets 0 keeps scanning until stop() or until the scanner reports an error, or until the feeder is
+    // empty when fromFeeder is set (the factory selects the feeder source)
+    void start(int maxSheets = 0, bool fromFeeder = false);
+    // Lets the sheet being scanned finish, later sheets are not acquired
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Called by the receiver of sheetReady once the sheet's photos are saved
+    void sheetSaved();
+    // The operator placed the next sheet on the flatbed
+    void nextSheet();
+
+signals:
+    void sheetScanned(int index);
+    // The flatbed is free, scanning sheet index waits for nextSheet()
+    void sheetRequested(int index);
+    void sheetReady(const ScanSession::Sheet &sheet);
+    void failed(const QString &message);
+    void finished(int sheets);
+
+private:
+    ScannerFactory scannerFactory;
+    const ScanProcessor::Options options;
+    const int queueDepth;
+
+    QThreadPool stagePool;
+    std::unique_ptr<BoundedQueue<Sheet>> scannedSheets;
+    QSemaphore saveSlots;
+    QSemaphore sheetRequests;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> abandoned{false};
+    std::atomic<bool> running{false};
+
+    void scanStage(int maxSheets, bool fromFeeder);
+    // Blocks until nextSheet() is called, false when the session stops first
+    bool waitForNextSheet(int index);
+    // Hands a scanned sheet to the detect stage, false when the session is shutting down
+    bool pushSheet(Sheet sheet);
+    void detectStage();
+    void post(std::function<void()> function);
+};
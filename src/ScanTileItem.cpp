@@ -0,0 +1,231 @@
+#include "ScanTileItem.h"
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QThreadPool>
+#include <QWidget>
+#include <algorithm>
+#include <cmath>
+
+// BGR or grayscale tile to a QImage that owns its pixels
+static QImage tileToQImage(const cv::Mat &tile) {
+    if (tile.type() == CV_8UC1) {
+        return QImage(tile.data, tile.cols, tile.rows, static_cast<int>(tile.step), QImage::Format_Grayscale8).copy();
+    }
+
+    cv::Mat rgb;
+    cv::cvtColor(tile, rgb, tile.channels() == 4 ? cv::COLOR_BGRA2RGB : cv::COLOR_BGR2RGB);
+    return QImage(rgb.data, rgb.cols, rgb.rows, static_cast<int>(rgb.step), QImage::Format_RGB888).copy();
+}
+
+static int levelsToFit(const ScanPyramid &pyramid, int tileSize) {
+    int level = 0;
+    for (cv::Size size = pyramid.levelSize(0); size.width > tileSize || size.height > tileSize; size = pyramid.levelSize(++level)) {
+    }
+    return level;
+}
+
+// Not owned by an item, so deleting one never waits for a tile being cut
+static QThreadPool *tilePool() {
+    static QThreadPool *pool = []() {
+        QThreadPool *tilePool = new QThreadPool(QCoreApplication::instance());
+        tilePool->setMaxThreadCount(2);
+        return tilePool;
+    }();
+    return pool;
+}
+
+bool ScanTileItem::JobState::wants(int tileLevel, int column, int row, quint64 requestGeneration, int coarsestLevel) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!item) {
+        return false;
+    }
+    // The coarsest tile is the fallback for every other one
+    return requestGeneration == generation || tileLevel == coarsestLevel ||
+           (tileLevel == level && visibleTiles.contains(column, row));
+}
+
+ScanTileItem::ScanTileItem(std::shared_ptr<ScanPyramid> pyramid, QGraphicsItem *parent)
+    : QGraphicsObject(parent), pyramid(std::move(pyramid)), maxLevel(levelsToFit(*this->pyramid, tileSize)),
+      jobState(std::make_shared<JobState>()), tiles(cacheKilobytes) {
+    jobState->item = this;
+    // paint() only walks the tiles in option->exposedRect
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+ScanTileItem::~ScanTileItem() {
+    // Queued jobs are skipped and running ones finish without posting their tile
+    std::lock_guard<std::mutex> lock(jobState->mutex);
+    jobState->item = nullptr;
+}
+
+QRectF ScanTileItem::boundingRect() const {
+    cv::Size size = pyramid->levelSize(0);
+    return QRectF(0, 0, size.width, size.height);
+}
+
+void ScanTileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    // The finest level whose pixels are still at least as large as a screen pixel
+    qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    int level = lod >= 1.0 ? 0 : std::clamp(static_cast<int>(std::floor(std::log2(1.0 / lod))), 0, maxLevel);
+
+    // The whole viewport decides which queued tiles are still wanted, not just the part being repainted
+    QRectF visible = widget ? painter->worldTransform().inverted().mapRect(QRectF(widget->rect())) : option->exposedRect;
+    setVisibleTiles(level, tilesCovering(level, visible));
+
+    QRect exposedTiles = tilesCovering(level, option->exposedRect);
+    for (int row = exposedTiles.top(); row <= exposedTiles.bottom(); row++) {
+        for (int column = exposedTiles.left(); column <= exposedTiles.right(); column++) {
+            QPixmap *tile = tiles.object(tileKey(level, column, row));
+            if (tile) {
+                painter->drawPixmap(sceneRect(level, tileRect(level, column, row)), *tile, QRectF(tile->rect()));
+                continue;
+            }
+
+            requestTile(level, column, row);
+            if (!paintFallback(painter, level, column, row)) {
+                // Nothing cached yet, a coarse version of the whole scan is the cheapest one to cut
+                requestTile(maxLevel, 0, 0);
+            }
+        }
+    }
+}
+
+QRect ScanTileItem::tilesCovering(int level, const QRectF &area) const {
+    QRectF clipped = area & boundingRect();
+    if (clipped.isEmpty()) {
+        return QRect();
+    }
+
+    cv::Size levelSize = pyramid->levelSize(level);
+    cv::Size baseSize = pyramid->levelSize(0);
+    double tileWidth = tileSize * static_cast<double>(baseSize.width) / levelSize.width;
+    double tileHeight = tileSize * static_cast<double>(baseSize.height) / levelSize.height;
+    int columns = (levelSize.width + tileSize - 1) / tileSize;
+    int rows = (levelSize.height + tileSize - 1) / tileSize;
+
+    int firstColumn = std::clamp(static_cast<int>(clipped.left() / tileWidth), 0, columns - 1);
+    int lastColumn = std::clamp(static_cast<int>(std::ceil(clipped.right() / tileWidth)) - 1, firstColumn, columns - 1);
+    int firstRow = std::clamp(static_cast<int>(clipped.top() / tileHeight), 0, rows - 1);
+    int lastRow = std::clamp(static_cast<int>(std::ceil(clipped.bottom() / tileHeight)) - 1, firstRow, rows - 1);
+    return QRect(QPoint(firstColumn, firstRow), QPoint(lastColumn, lastRow));
+}
+
+void ScanTileItem::setVisibleTiles(int level, const QRect &visibleTiles) {
+    if (level == jobState->level && visibleTiles == jobState->visibleTiles) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobState->mutex);
+        jobState->generation++;
+        jobState->level = level;
+        jobState->visibleTiles = visibleTiles;
+    }
+
+    // Tiles out of view may be requested again when they come back, their queued jobs are skipped
+    for (auto it = pending.begin(); it != pending.end();) {
+        int tileLevel = static_cast<int>(*it >> 48);
+        int row = static_cast<int>((*it >> 24) & 0xFFFFFF);
+        int column = static_cast<int>(*it & 0xFFFFFF);
+        bool wanted = tileLevel == maxLevel || (tileLevel == level && visibleTiles.contains(column, row));
+        it = wanted ? std::next(it) : pending.erase(it);
+    }
+}
+
+bool ScanTileItem::paintFallback(QPainter *painter, int level, int column, int row) {
+    QRectF target = sceneRect(level, tileRect(level, column, row));
+
+    for (int coarser = level + 1; coarser <= maxLevel; coarser++) {
+        int shift = coarser - level;
+        int coarseColumn = column >> shift;
+        int coarseRow = row >> shift;
+        QPixmap *tile = tiles.object(tileKey(coarser, coarseColumn, coarseRow));
+        if (!tile) {
+            continue;
+        }
+
+        // The part of the coarse tile that lies under the missing one
+        QRectF coarseRect = sceneRect(coarser, tileRect(coarser, coarseColumn, coarseRow));
+        QRectF covered = target & coarseRect;
+        if (covered.isEmpty()) {
+            continue;
+        }
+        double sx = tile->width() / coarseRect.width();
+        double sy = tile->height() / coarseRect.height();
+        QRectF source((covered.left() - coarseRect.left()) * sx, (covered.top() - coarseRect.top()) * sy,
+                      covered.width() * sx, covered.height() * sy);
+        painter->drawPixmap(covered, *tile, source);
+        return true;
+    }
+    return false;
+}
+
+void ScanTileItem::requestTile(int level, int column, int row) {
+    quint64 key = tileKey(level, column, row);
+    if (tiles.contains(key) || pending.count(key)) {
+        return;
+    }
+    if (static_cast<int>(pending.size()) >= maxQueuedTiles) {
+        // Asked for again by the repaint after the next tile arrives
+        deferredRequests = true;
+        return;
+    }
+    pending.insert(key);
+
+    QRect rect = tileRect(level, column, row);
+    std::shared_ptr<ScanPyramid> source = pyramid;
+    std::shared_ptr<JobState> state = jobState;
+    quint64 generation = jobState->generation;
+    int coarsestLevel = maxLevel;
+    tilePool()->start([source, state, level, column, row, rect, key, generation, coarsestLevel]() {
+        if (!state->wants(level, column, row, generation, coarsestLevel)) {
+            return;
+        }
+
+        // The first tile of a level also builds that level of the pyramid
+        cv::Mat levelImage = source->level(level);
+        QImage image = tileToQImage(levelImage(cv::Rect(rect.x(), rect.y(), rect.width(), rect.height())));
+
+        // Holding the lock keeps the item alive until the call is queued, a queued call to a
+        // deleted item is discarded
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (ScanTileItem *item = state->item) {
+            QMetaObject::invokeMethod(item, [item, key, image, level, rect]() {
+                item->tileReady(key, image, level, rect);
+            }, Qt::QueuedConnection);
+        }
+    }, ++requestSerial);
+}
+
+void ScanTileItem::tileReady(quint64 key, const QImage &image, int level, const QRect &rect) {
+    pending.erase(key);
+    // QPixmaps are only made on the GUI thread
+    tiles.insert(key, new QPixmap(QPixmap::fromImage(image)), std::max<qsizetype>(1, image.sizeInBytes() / 1024));
+    update(sceneRect(level, rect));
+
+    if (deferredRequests) {
+        deferredRequests = false;
+        update();
+    }
+}
+
+quint64 ScanTileItem::tileKey(int level, int column, int row) {
+    return (static_cast<quint64>(level) << 48) | (static_cast<quint64>(row) << 24) | static_cast<quint64>(column);
+}
+
+QRect ScanTileItem::tileRect(int level, int column, int row) const {
+    cv::Size size = pyramid->levelSize(level);
+    return QRect(column * tileSize, row * tileSize, tileSize, tileSize) & QRect(0, 0, size.width, size.height);
+}
+
+QRectF ScanTileItem::sceneRect(int level, const QRect &levelRect) const {
+    // Levels are rounded at every halving, so scale by the actual size ratio instead of 2^level
+    cv::Size levelSize = pyramid->levelSize(level);
+    cv::Size baseSize = pyramid->levelSize(0);
+    double sx = static_cast<double>(baseSize.width) / levelSize.width;
+    double sy = static_cast<double>(baseSize.height) / levelSize.height;
+    return QRectF(levelRect.x() * sx, levelRect.y() * sy, levelRect.width() * sx, levelRect.height() * sy);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ScanPyramid.h"
+#include <QCache>
+#include <QGraphicsObject>
+#include <QPixmap>
+#include <QRect>
+#include <memory>
+#include <mutex>
+#include <set>
+
+/**
+ * Draws a scan as tiles taken from its ScanPyramid, at the level matching the current zoom:
+ * level 0 when a scan pixel covers a screen pixel or more, one level up every time the view
+ * halves. Only the tiles in the exposed rect are drawn. Missing tiles are cut and converted on
+ * a background pool and painted when they arrive; until then the nearest coarser tile in the
+ * cache stands in. The item covers the scan in its own pixel coordinates, like a pixmap item.
+ *
+ * Tile jobs outlive the item: deleting it does not wait for them, their results are dropped.
+ * Jobs for tiles that were scrolled or zoomed out of view while queued are skipped.
+ */
+class ScanTileItem : public QGraphicsObject
+{
+    Q_OBJECT
+public:
+    explicit ScanTileItem(std::shared_ptr<ScanPyramid> pyramid, QGraphicsItem *parent = nullptr);
+    ~ScanTileItem() override;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    static constexpr int tileSize = 256;             // Pixels of a tile at its own level
+    static constexpr int cacheKilobytes = 256 * 1024; // Converted tiles kept across paints
+    static constexpr int maxQueuedTiles = 32;        // Further requests wait until these are done
+
+private:
+    // Shared with the tile jobs. Every change of the visible tiles bumps the generation, jobs from
+    // an older generation only run when their tile is still visible.
+    struct JobState {
+        std::mutex mutex;
+        ScanTileItem *item; // nullptr once the item is deleted
+        quint64 generation = 0;
+        int level = -1;
+        QRect visibleTiles; // Columns and rows of level in view
+
+        bool wants(int tileLevel, int column, int row, quint64 requestGeneration, int coarsestLevel);
+    };
+
+    std::shared_ptr<ScanPyramid> pyramid;
+    const int maxLevel; // The level at which the whole scan fits in one tile
+    std::shared_ptr<JobState> jobState;
+
+    QCache<quint64, QPixmap> tiles;
+    std::set<quint64> pending;
+    bool deferredRequests = false; // Tiles were not requested because maxQueuedTiles were pending
+    int requestSerial = 0; // Newer requests run first, tiles scrolled past may still be queued
+
+    static quint64 tileKey(int level, int column, int row);
+    QRect tileRect(int level, int column, int row) const; // In pixels of that level
+    QRectF sceneRect(int level, const QRect &levelRect) const;
+    // Columns and rows of level covering area, which is in item coordinates
+    QRect tilesCovering(int level, const QRectF &area) const;
+
+    void setVisibleTiles(int level, const QRect &visibleTiles);
+    void requestTile(int level, int column, int row);
+    void tileReady(quint64 key, const QImage &image, int level, const QRect &rect);
+    // Paints the part of a coarser cached tile that covers the tile, false when there is none
+    bool paintFallback(QPainter *painter, int level, int column, int row);
+};
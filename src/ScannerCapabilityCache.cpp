@@ -0,0 +1,115 @@
+#include "ScannerCapabilityCache.h"
+
+#include "AtomicFile.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+ScannerCapabilityCache::ScannerCapabilityCache(const QString &filePath) : filePath(filePath) {
+    load();
+}
+
+QString ScannerCapabilityCache::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/scanner-capabilities.json";
+}
+
+QStringList ScannerCapabilityCache::devices() const {
+    QStringList devices;
+    for (const auto &device : root["devices"].toArray()) {
+        devices += device.toString();
+    }
+    return devices;
+}
+
+void ScannerCapabilityCache::setDevices(const QStringList &devices) {
+    if (devices == this->devices()) {
+        return;
+    }
+    root["devices"] = QJsonArray::fromStringList(devices);
+    save();
+}
+
+bool ScannerCapabilityCache::lookup(const QString &deviceId, ScannerInterface::Capabilities &capabilities) const {
+    QJsonObject entries = root["capabilities"].toObject();
+    if (!entries.contains(deviceId)) {
+        return false;
+    }
+    capabilities = fromJson(entries[deviceId].toObject());
+    return true;
+}
+
+bool ScannerCapabilityCache::needsRevalidation(const QString &deviceId) const {
+    QJsonObject entry = root["capabilities"].toObject()[deviceId].toObject();
+    QDateTime checked = QDateTime::fromString(entry["checked"].toString(), Qt::ISODate);
+    return !checked.isValid() || checked.daysTo(QDateTime::currentDateTimeUtc()) > maxAgeDays;
+}
+
+void ScannerCapabilityCache::store(const QString &deviceId, const ScannerInterface::Capabilities &capabilities) {
+    QJsonObject entry = toJson(capabilities);
+    entry["checked"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QJsonObject entries = root["capabilities"].toObject();
+    entries[deviceId] = entry;
+    root["capabilities"] = entries;
+    save();
+}
+
+void ScannerCapabilityCache::load() {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // A damaged cache is only a slower start, it is rebuilt by the next discovery
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (doc.isObject()) {
+        root = doc.object();
+    } else {
+        qWarning() << "ScannerCapabilityCache: ignoring invalid" << filePath;
+    }
+}
+
+void ScannerCapabilityCache::save() const {
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    if (!AtomicFile::write(filePath, QJsonDocument(root).toJson(), AtomicFile::Durability::None)) {
+        qWarning() << "ScannerCapabilityCache: failed to write" << filePath;
+    }
+}
+
+QJsonObject ScannerCapabilityCache::toJson(const ScannerInterface::Capabilities &capabilities) {
+    QJsonArray resolutions;
+    for (int dpi : capabilities.resolutions) {
+        resolutions.append(dpi);
+    }
+    QJsonArray colorOptions;
+    for (int colorOption : capabilities.colorOptions) {
+        colorOptions.append(colorOption);
+    }
+
+    QJsonObject obj;
+    obj["resolutions"] = resolutions;
+    obj["minDpi"] = capabilities.minDpi;
+    obj["maxDpi"] = capabilities.maxDpi;
+    obj["colorOptions"] = colorOptions;
+    obj["hasFeeder"] = capabilities.hasFeeder;
+    return obj;
+}
+
+ScannerInterface::Capabilities ScannerCapabilityCache::fromJson(const QJsonObject &obj) {
+    ScannerInterface::Capabilities capabilities;
+    for (const auto &dpi : obj["resolutions"].toArray()) {
+        capabilities.resolutions.push_back(dpi.toInt());
+    }
+    capabilities.minDpi = obj["minDpi"].toInt();
+    capabilities.maxDpi = obj["maxDpi"].toInt();
+    for (const auto &colorOption : obj["colorOptions"].toArray()) {
+        capabilities.colorOptions.push_back(colorOption.toInt());
+    }
+    capabilities.hasFeeder = obj["hasFeeder"].toBool();
+    return capabilities;
+}
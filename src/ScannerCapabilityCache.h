@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ScannerInterface.h"
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Scanner list and per device capabilities remembered between runs, so the window can offer the
+ * last known scanners and their options without waiting for the drivers. Devices are keyed by the
+ * name the backend reports (the SANE device name, the WIA device name). Entries are revalidated
+ * lazily: needsRevalidation() tells when a selected device should be queried again.
+ * Not thread safe, use it from the GUI thread.
+ */
+class ScannerCapabilityCache
+{
+public:
+    explicit ScannerCapabilityCache(const QString &filePath = defaultPath());
+
+    // scanner-capabilities.json in the per-user application data folder
+    static QString defaultPath();
+
+    QStringList devices() const;
+    void setDevices(const QStringList &devices);
+
+    bool lookup(const QString &deviceId, ScannerInterface::Capabilities &capabilities) const;
+    // True when the device was never queried or its entry is older than maxAgeDays
+    bool needsRevalidation(const QString &deviceId) const;
+    void store(const QString &deviceId, const ScannerInterface::Capabilities &capabilities);
+
+    static constexpr int maxAgeDays = 30;
+
+private:
+    QString filePath;
+    QJsonObject root;
+
+    void load();
+    void save() const;
+
+    static QJsonObject toJson(const ScannerInterface::Capabilities &capabilities);
+    static ScannerInterface::Capabilities fromJson(const QJsonObject &obj);
+};
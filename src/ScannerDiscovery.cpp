@@ -0,0 +1,47 @@
+#include "ScannerDiscovery.h"
+
+#include "ScannerInterface.h"
+#include <QtConcurrent>
+
+ScannerDiscovery::ScannerDiscovery(QObject *parent) : QObject(parent) {
+    pool.setMaxThreadCount(1);
+}
+
+ScannerDiscovery::~ScannerDiscovery() {
+    // A driver call cannot be interrupted, the enumeration finishes and its result is dropped
+    pool.waitForDone();
+}
+
+void ScannerDiscovery::discover() {
+    if (discovering.exchange(true)) {
+        return;
+    }
+
+    QtConcurrent::run(&pool, [this]() {
+        try {
+            std::unique_ptr<ScannerInterface> scanner = ScannerInterface::createScanner();
+            if (!scanner) {
+                throw std::runtime_error("No suitable scanner backend found!");
+            }
+
+            QStringList scanners;
+            for (const auto &name : scanner->getAvailableScanners()) {
+                scanners += QString::fromStdWString(name);
+            }
+            post([this, scanners]() {
+                discovering = false;
+                emit scannersFound(scanners);
+            });
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            post([this, message]() {
+                discovering = false;
+                emit discoveryFailed(message);
+            });
+        }
+    });
+}
+
+void ScannerDiscovery::post(std::function<void()> function) {
+    QMetaObject::invokeMethod(this, std::move(function), Qt::QueuedConnection);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+
+/**
+ * Enumerates the attached scanners on a background thread, so neither startup nor the
+ * "find scanners" button wait for slow drivers. The backend used for the enumeration is
+ * created, used and destroyed on that thread; results are delivered on the GUI thread.
+ */
+class ScannerDiscovery : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScannerDiscovery(QObject *parent = nullptr);
+    ~ScannerDiscovery();
+
+    // Ignored while an enumeration is already running
+    void discover();
+    bool isDiscovering() const { return discovering; }
+
+signals:
+    void scannersFound(const QStringList &scanners);
+    void discoveryFailed(const QString &message);
+
+private:
+    QThreadPool pool;
+    std::atomic<bool> discovering{false};
+
+    void post(std::function<void()> function);
+};
@@ -1,4 +1,5 @@
 #include "ScannerInterface.h"
+#include "ReplayScanner.h"
 #ifdef __linux__
 #include "SaneScanner.h"
 #endif
@@ -10,6 +11,11 @@
 
 std::unique_ptr<ScannerInterface> ScannerInterface::createScanner()
 {
+    // A replay directory overrides the platform backend, for headless benchmarks and field issue repros
+    if (ReplayScanner::isConfigured()) {
+        return std::make_unique<ReplayScanner>(ReplayScanner::optionsFromEnvironment());
+    }
+
 #ifdef __linux__
     return std::make_unique<SaneScanner>();
 #elif defined(_WIN32)
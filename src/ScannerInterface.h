@@ -1,11 +1,68 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Shared flag to abort a streamed scan, copies refer to the same flag so cancel() may be called from any thread
+class ScanCancelToken
+{
+public:
+    void cancel() { flag->store(true); }
+    bool isCancelled() const { return flag->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+};
+
+// Thrown by scanImageStreamed once the device stopped after a cancel
+class ScanCancelled : public std::runtime_error
+{
+public:
+    ScanCancelled() : std::runtime_error("Scan cancelled") {}
+};
 
 class ScannerInterface
 {
 public:
+    enum class Source {
+        Flatbed,
+        Feeder // Automatic document feeder or photo sleeve feeder
+    };
+
+    // What the selected device supports, empty fields mean the backend could not tell
+    struct Capabilities {
+        std::vector<int> resolutions; // Discrete DPI values, empty when the device takes a range
+        int minDpi = 0;
+        int maxDpi = 0;
+        std::vector<int> colorOptions; // Same numbering as setColorOption: 1 colour, 2 grayscale, 3 black and white
+        bool hasFeeder = false;
+
+        bool supportsDpi(int dpi) const {
+            if (!resolutions.empty()) {
+                return std::find(resolutions.begin(), resolutions.end(), dpi) != resolutions.end();
+            }
+            return maxDpi <= 0 || (dpi >= minDpi && dpi <= maxDpi);
+        }
+        bool supportsColorOption(int colorOption) const {
+            return colorOptions.empty() ||
+                   std::find(colorOptions.begin(), colorOptions.end(), colorOption) != colorOptions.end();
+        }
+    };
+
+    // Receives rows [firstRow, firstRow + band.rows) of the image in BGR, expectedRows is -1 when the
+    // device does not know the height up front. The band is only valid during the call.
+    using BandCallback = std::function<void(const cv::Mat &band, int firstRow, int expectedRows)>;
+    // Fraction of the image transferred, from 0 to 1
+    using ProgressCallback = std::function<void(double fraction)>;
+
+    // Receives each page of a batch as soon as it is transferred, returns false to stop after it
+    using PageCallback = std::function<bool(const cv::Mat &page)>;
+
     virtual ~ScannerInterface() = default;
 
     // Getter for available scanners
@@ -13,6 +70,21 @@ public:
     // The core function: scan an image from the scanner
     // For multi-page scanning or advanced controls, add more methods
     virtual cv::Mat scanImage() = 0;
+    // Same image as scanImage, with bands and progress delivered on the calling thread while the data
+    // arrives. cancel is checked between transfers. Backends that cannot stream deliver one band at the end.
+    virtual cv::Mat scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) {
+        if (cancel.isCancelled()) {
+            throw ScanCancelled();
+        }
+        cv::Mat image = scanImage();
+        if (onProgress) {
+            onProgress(1.0);
+        }
+        if (onBand) {
+            onBand(image, 0, image.rows);
+        }
+        return image;
+    }
 
     // Get a list of available scanners
     // virtual void populateAvailableScanners();
@@ -22,6 +94,28 @@ public:
     virtual void setDpi(int dpi) = 0;
     virtual void setColorOption(int colorOption) = 0;
 
+    // Asks the selected device for its capabilities, which can take a while on some drivers,
+    // so callers cache the result (see ScannerCapabilityCache)
+    virtual Capabilities queryCapabilities() { return Capabilities(); }
+
+    // Restricts the following scans to an area of the bed, in inches from its top left corner.
+    // Returns the area the device will actually scan, which backends round and clip to the bed, or an
+    // empty rect when the backend cannot restrict it. Scans then keep covering the whole bed.
+    virtual cv::Rect2d setScanArea(const cv::Rect2d &areaInches) { (void)areaInches; return cv::Rect2d(); }
+    virtual void clearScanArea() {}
+
+    // Returns false when the device has no such source
+    virtual bool setSource(Source source) { return source == Source::Flatbed; }
+
+    // Scans pages with the device session kept open until the feeder runs empty, maxPages have been
+    // scanned (0 for no limit) or onPage returns false. Returns the number of pages delivered.
+    // Backends without a feeder deliver a single scanImage().
+    virtual int scanBatch(const PageCallback &onPage, int maxPages = 0) {
+        (void)maxPages;
+        onPage(scanImage());
+        return 1;
+    }
+
     // Static factory: returns appropriate scanner for the current platform
     static std::unique_ptr<ScannerInterface> createScanner();
 };
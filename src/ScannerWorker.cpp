@@ -0,0 +1,30 @@
+#include "ScannerWorker.h"
+
+#include <QDebug>
+
+ScannerWorker::ScannerWorker(QObject *parent) : QObject(parent) {
+    // A single thread that never expires, so the scanner is always called from the thread that created it
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(-1);
+}
+
+ScannerWorker::~ScannerWorker() {
+    pool.clear();
+    submit([](std::unique_ptr<ScannerInterface> &scanner) { scanner.reset(); });
+    pool.waitForDone();
+}
+
+void ScannerWorker::submit(Task task) {
+    pool.start([this, task = std::move(task)]() {
+        try {
+            task(scanner);
+        } catch (const std::exception &e) {
+            // Tasks report their own errors, this only keeps the thread alive
+            qWarning() << "ScannerWorker: task failed:" << e.what();
+        }
+    });
+}
+
+void ScannerWorker::post(std::function<void()> function) {
+    QMetaObject::invokeMethod(this, std::move(function), Qt::QueuedConnection);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ScannerInterface.h"
+#include <QObject>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+
+/**
+ * Owns the scanner the window works with and makes every call to it on one dedicated thread:
+ * opening the device, capability queries, settings and scans. COM based backends stay in the
+ * apartment they were created in and a slow driver never blocks the GUI. Tasks run one at a
+ * time in the order they were submitted, results are handed back to the GUI thread with post().
+ */
+class ScannerWorker : public QObject
+{
+    Q_OBJECT
+public:
+    // The scanner is null until a task creates it, a task may also reset it to close the device
+    using Task = std::function<void(std::unique_ptr<ScannerInterface> &scanner)>;
+
+    explicit ScannerWorker(QObject *parent = nullptr);
+    // Drops the tasks not started yet, waits for the running one and closes the scanner on its thread.
+    // Cancel a running scan first.
+    ~ScannerWorker();
+
+    void submit(Task task);
+    // Runs function on the GUI thread, dropped once the worker is deleted. May be called from any thread.
+    void post(std::function<void()> function);
+
+private:
+    QThreadPool pool;
+    std::unique_ptr<ScannerInterface> scanner; // Only touched on the pool thread
+};
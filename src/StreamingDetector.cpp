@@ -0,0 +1,250 @@
+#include "StreamingDetector.h"
+
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+StreamingDetector::StreamingDetector(const ScanProcessor::Options &options, int width, int expectedRows)
+    : processor(options),
+      scale(options.detectionMode == ScanProcessor::DetectionMode::Pyramid ? processor.proxyScale() : 1.0f),
+      width(width),
+      proxyWidth(std::max(1, cvRound(width / scale))),
+      closeMargin(scale > 1.0f ? static_cast<int>(std::ceil(ScanProcessor::refineRadius(scale) / scale)) + 1 : 1),
+      heightKnown(expectedRows > 0) {
+    // Unknown heights are estimated as a letter size sheet
+    int estimatedRows = heightKnown ? expectedRows : cvRound(width * 11 / 8.5);
+    int estimatedProxyRows = std::max(1, cvRound(estimatedRows / scale));
+    minProxyArea = static_cast<double>(proxyWidth) * estimatedProxyRows / 8;
+
+    proxyMask.create(estimatedProxyRows, proxyWidth, CV_8UC1);
+    proxyLabels.create(estimatedProxyRows, proxyWidth, CV_32SC1);
+
+    // Label 0 is the background
+    components.push_back({0, cv::Rect(), -1});
+}
+
+void StreamingDetector::addBand(const cv::Mat &band) {
+    appendRows(band);
+
+    // Only whole blocks of scale x scale pixels, the last partial block waits for the next band
+    addProxyRows(rows / static_cast<int>(scale));
+    closeComponents(proxyRows - closeMargin);
+}
+
+std::vector<DetectedRegion> StreamingDetector::finish(const cv::Mat &image) {
+    if (image.rows != rows || image.cols != width) {
+        throw std::invalid_argument("StreamingDetector: the image must be made of the bands fed");
+    }
+
+    // Same proxy height and area filter as cv::resize and findQuads give for the whole scan
+    int finalProxyRows = std::max(proxyRows, cvRound(rows / scale));
+    if (!heightKnown) {
+        minProxyArea = static_cast<double>(proxyWidth) * finalProxyRows / 8;
+    }
+
+    addProxyRows(finalProxyRows);
+    closeComponents(INT_MAX);
+
+    // A scan shorter than estimated lowers the filter, photos it rejected while streaming may pass now
+    std::vector<int> retry;
+    retry.swap(rejectedRoots);
+    for (int root : retry) {
+        fitComponent(root);
+    }
+
+    std::vector<QuadFit> quads = fitted;
+    if (scale > 1.0f && !quads.empty()) {
+        quads = processor.refineProxyQuads(image, quads, scale);
+    }
+
+    std::vector<DetectedRegion> regions;
+    for (const auto &quad : quads) {
+        regions.push_back(processor.makeRegion(image, quad));
+    }
+    return regions;
+}
+
+void StreamingDetector::appendRows(const cv::Mat &band) {
+    if (band.type() != CV_8UC3 || band.cols != width) {
+        throw std::invalid_argument("StreamingDetector: bands must be BGR and as wide as the scan");
+    }
+
+    if (pendingRows.empty()) {
+        pendingRows = band.clone();
+    } else {
+        cv::vconcat(pendingRows, band, pendingRows);
+    }
+    rows += band.rows;
+}
+
+void StreamingDetector::addProxyRows(int targetRows) {
+    if (targetRows <= proxyRows) {
+        return;
+    }
+
+    // 1. Downscale the new rows, INTER_AREA averages whole blocks of pixels like the batch proxy
+    const int blockRows = static_cast<int>(scale);
+    const int consumed = std::min(rows, targetRows * blockRows) - proxyRows * blockRows;
+    cv::Mat source = pendingRows.rowRange(0, consumed);
+    cv::Mat proxy;
+    if (scale > 1.0f) {
+        cv::resize(source, proxy, cv::Size(proxyWidth, targetRows - proxyRows), 0, 0, cv::INTER_AREA);
+    } else {
+        proxy = source;
+    }
+
+    // 2. Threshold them into the proxy mask
+    cv::Mat mask;
+    ScanProcessor::saturationMask(proxy, mask);
+    ensureRows(proxyMask, targetRows, CV_8UC1, proxyWidth);
+    ensureRows(proxyLabels, targetRows, CV_32SC1, proxyWidth);
+    mask.copyTo(proxyMask.rowRange(proxyRows, targetRows));
+
+    // 3. Join them to the components above
+    for (int y = proxyRows; y < targetRows; y++) {
+        labelRow(y);
+    }
+    proxyRows = targetRows;
+
+    // Only the rows of the next, partial block are kept
+    pendingRows = consumed < pendingRows.rows ? pendingRows.rowRange(consumed, pendingRows.rows).clone() : cv::Mat();
+}
+
+void StreamingDetector::labelRow(int y) {
+    const uchar *mask = proxyMask.ptr<uchar>(y);
+    int *labels = proxyLabels.ptr<int>(y);
+    const int *above = y > 0 ? proxyLabels.ptr<int>(y - 1) : nullptr;
+
+    int x = 0;
+    while (x < proxyWidth) {
+        if (!mask[x]) {
+            labels[x] = 0;
+            x++;
+            continue;
+        }
+
+        // A run of foreground pixels, joined to every component touching it from above (8-connected)
+        int start = x;
+        while (x < proxyWidth && mask[x]) {
+            x++;
+        }
+
+        int root = 0;
+        for (int ax = std::max(0, start - 1); above && ax < std::min(proxyWidth, x + 1); ax++) {
+            if (above[ax]) {
+                root = root ? unite(root, above[ax]) : findRoot(above[ax]);
+            }
+        }
+
+        cv::Rect run(start, y, x - start, 1);
+        if (!root) {
+            root = static_cast<int>(components.size());
+            components.push_back({root, run, y});
+            openRoots.insert(root);
+        } else {
+            components[root].box |= run;
+            components[root].lastRow = y;
+        }
+        std::fill(labels + start, labels + x, root);
+    }
+}
+
+void StreamingDetector::closeComponents(int beforeRow) {
+    // A component without pixels in the newest rows can not grow any more
+    std::vector<int> closed;
+    for (int root : openRoots) {
+        if (components[root].lastRow < beforeRow) {
+            closed.push_back(root);
+        }
+    }
+    for (int root : closed) {
+        openRoots.erase(root);
+        fitComponent(root);
+    }
+}
+
+void StreamingDetector::fitComponent(int root) {
+    const Component &component = components[root];
+    // The contour area is below the box area, so small components are skipped without tracing them
+    if (component.box.area() <= minProxyArea) {
+        if (!heightKnown) {
+            rejectedRoots.push_back(root);
+        }
+        return;
+    }
+
+    // 1. Mask of this component only, other components may reach into its box
+    cv::Rect roi(component.box.x - 1, component.box.y - 1, component.box.width + 2, component.box.height + 2);
+    roi &= cv::Rect(0, 0, proxyWidth, proxyRows);
+    cv::Mat mask = cv::Mat::zeros(roi.size(), CV_8UC1);
+    for (int y = 0; y < roi.height; y++) {
+        const int *labels = proxyLabels.ptr<int>(roi.y + y) + roi.x;
+        uchar *target = mask.ptr<uchar>(y);
+        for (int x = 0; x < roi.width; x++) {
+            if (labels[x] && findRoot(labels[x]) == root) {
+                target[x] = 255;
+            }
+        }
+    }
+
+    // 2. Its outline, in proxy coordinates
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, roi.tl());
+    auto largest = std::max_element(contours.begin(), contours.end(), [](const auto &a, const auto &b) {
+        return cv::contourArea(a) < cv::contourArea(b);
+    });
+    if (largest == contours.end()) {
+        return;
+    }
+    if (cv::contourArea(*largest) <= minProxyArea) {
+        if (!heightKnown) {
+            rejectedRoots.push_back(root);
+        }
+        return;
+    }
+
+    // 3. Fit the quad, it is refined at full resolution in finish()
+    QuadFit quad = processor.fitContour(*largest);
+    if (!quad.corners.empty()) {
+        fitted.push_back(quad);
+    }
+}
+
+int StreamingDetector::findRoot(int label) {
+    while (components[label].parent != label) {
+        // Path halving
+        components[label].parent = components[components[label].parent].parent;
+        label = components[label].parent;
+    }
+    return label;
+}
+
+int StreamingDetector::unite(int a, int b) {
+    int rootA = findRoot(a);
+    int rootB = findRoot(b);
+    if (rootA == rootB) {
+        return rootA;
+    }
+
+    // The older component absorbs the newer one
+    if (rootB < rootA) {
+        std::swap(rootA, rootB);
+    }
+    components[rootB].parent = rootA;
+    components[rootA].box |= components[rootB].box;
+    components[rootA].lastRow = std::max(components[rootA].lastRow, components[rootB].lastRow);
+    openRoots.erase(rootB);
+    return rootA;
+}
+
+void StreamingDetector::ensureRows(cv::Mat &mat, int rows, int type, int cols) {
+    if (mat.rows >= rows) {
+        return;
+    }
+
+    cv::Mat grown(std::max(rows, mat.rows * 2), cols, type);
+    if (!mat.empty()) {
+        mat.copyTo(grown.rowRange(0, mat.rows));
+    }
+    mat = grown;
+}
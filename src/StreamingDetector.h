@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ScanProcessor.h"
+#include <opencv2/opencv.hpp>
+#include <set>
+#include <vector>
+
+/**
+ * Photo detection that runs while the scan is transferred. Bands are fed top to bottom, each one
+ * is thresholded (on the proxy in Pyramid mode) and its rows are joined to the connected components
+ * of the rows above. A component that no longer reaches the newest row is complete: its contour is
+ * fitted right away, so only the photos touching the last band are left for finish(). The quads are
+ * refined at full resolution in finish(), on the scan the caller assembled, so the detector keeps
+ * the proxy and less than one block of scan rows instead of a second copy of the scan.
+ *
+ * Differences to ScanProcessor::detectAndCropPhotos:
+ *  - the 1/8 area filter uses the expected scan size. When the height is unknown it is estimated,
+ *    the components the estimate rejected are checked again in finish() against the real height.
+ *  - a photo lying inside the outline of another one is reported on its own
+ * Not thread safe, feed and query it from one thread.
+ */
+class StreamingDetector
+{
+public:
+    // expectedRows -1 when the scanner does not know the height up front
+    StreamingDetector(const ScanProcessor::Options &options, int width, int expectedRows);
+
+    // band is BGR, width columns, and continues right below the previous one
+    void addBand(const cv::Mat &band);
+    // Photos fitted so far
+    int photosFound() const { return static_cast<int>(fitted.size()); }
+    // Completes the photos touching the last band and refines all of them on image, the bands put
+    // together. The crops of the regions refer to image.
+    std::vector<DetectedRegion> finish(const cv::Mat &image);
+
+    int rowsReceived() const { return rows; }
+
+private:
+    struct Component {
+        int parent;
+        cv::Rect box; // Proxy coordinates
+        int lastRow;
+    };
+
+    ScanProcessor processor;
+    const float scale;     // Scan pixels per proxy pixel, 1 in FullResolution mode
+    const int width;
+    const int proxyWidth;
+    const int closeMargin; // Proxy rows a component must be behind the newest row before it is fitted
+    const bool heightKnown;
+    double minProxyArea;   // Contours up to this area are not photos, 1/8 of the scan as in findQuads
+
+    cv::Mat pendingRows; // Scan rows below the last whole block, not in the proxy yet
+    int rows = 0;
+
+    cv::Mat proxyMask;   // CV_8UC1, thresholded proxy rows
+    cv::Mat proxyLabels; // CV_32SC1, component label per mask pixel, 0 for background
+    int proxyRows = 0;
+
+    std::vector<Component> components; // Index 0 is unused, labels start at 1
+    std::set<int> openRoots;
+    std::vector<QuadFit> fitted; // Proxy coordinates
+    std::vector<int> rejectedRoots; // Closed components below the estimated minProxyArea
+
+    void appendRows(const cv::Mat &band);
+    void addProxyRows(int fullRows);
+    void labelRow(int y);
+    void closeComponents(int beforeRow);
+    void fitComponent(int root);
+
+    int findRoot(int label);
+    int unite(int a, int b);
+    static void ensureRows(cv::Mat &mat, int rows, int type, int cols);
+};
@@ -2,7 +2,11 @@
 
 #include "WiaScanner.h"
 
+#include <algorithm>
 #include <comdef.h>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <stdexcept>
@@ -132,9 +136,7 @@ void WiaScanner::setPreferredScanner(const std::wstring &scannerName) {
     if (selectedDevice)
         selectedDevice->Release();
     selectedDevice = device;
-
-    getDpiConstraints();
-    getColorOptions();
+    feederSelected = false;
 }
 
 IWiaItem *WiaScanner::findDeviceByName(const std::wstring &name) {
@@ -303,9 +305,133 @@ void WiaScanner::setScannerProperty(const std::wstring &propertyName, const std:
     }
 }
 
-// Minimal IWiaDataCallback implementation
+// Turns the WiaImgFmt_MEMORYBMP bytes of a banded transfer into BGR rows: a BITMAPINFOHEADER and
+// its palette come first, then the rows padded to 4 bytes. The driver sends the bytes in order.
+class DibBandReader {
+public:
+    explicit DibBandReader(const ScannerInterface::BandCallback &onBand) : onBand(onBand) {}
+
+    void add(const BYTE *data, LONG length) {
+        pending.insert(pending.end(), data, data + length);
+        if (!headerRead && !readHeader()) {
+            return;
+        }
+
+        int firstRow = rows;
+        size_t offset = 0;
+        while (pending.size() - offset >= stride) {
+            appendRow(pending.data() + offset);
+            offset += stride;
+        }
+        pending.erase(pending.begin(), pending.begin() + offset);
+
+        // Bottom-up bitmaps are only complete once the last row arrived
+        if (topDown && rows > firstRow && onBand) {
+            onBand(image.rowRange(firstRow, rows), firstRow, expectedRows);
+        }
+    }
+
+    // The rows received, top row first
+    cv::Mat finish() {
+        if (rows == 0) {
+            return cv::Mat();
+        }
+        cv::Mat result = image.rowRange(0, rows);
+        if (!topDown) {
+            cv::flip(result, result, 0);
+            if (onBand) {
+                onBand(result, 0, rows);
+            }
+        }
+        return result;
+    }
+
+private:
+    const ScannerInterface::BandCallback &onBand;
+    std::vector<BYTE> pending;
+    bool headerRead = false;
+    bool topDown = true;
+    int width = 0;
+    int bitCount = 0;
+    size_t stride = 0;
+    int expectedRows = -1;
+    std::vector<cv::Vec3b> palette;
+    cv::Mat image; // Grown when the height is unknown
+    int rows = 0;
+
+    bool readHeader() {
+        if (pending.size() < sizeof(BITMAPINFOHEADER)) {
+            return false;
+        }
+        BITMAPINFOHEADER header;
+        memcpy(&header, pending.data(), sizeof(header));
+        if (header.biWidth <= 0 || header.biCompression != BI_RGB ||
+            (header.biBitCount != 1 && header.biBitCount != 8 && header.biBitCount != 24 && header.biBitCount != 32)) {
+            throw std::runtime_error("Unsupported bitmap format in the banded transfer");
+        }
+
+        size_t colors = header.biClrUsed ? header.biClrUsed : (header.biBitCount <= 8 ? 1u << header.biBitCount : 0);
+        size_t headerSize = header.biSize + colors * sizeof(RGBQUAD);
+        if (pending.size() < headerSize) {
+            return false;
+        }
+        for (size_t i = 0; i < colors; i++) {
+            RGBQUAD color;
+            memcpy(&color, pending.data() + header.biSize + i * sizeof(RGBQUAD), sizeof(color));
+            palette.emplace_back(color.rgbBlue, color.rgbGreen, color.rgbRed);
+        }
+        pending.erase(pending.begin(), pending.begin() + headerSize);
+
+        width = header.biWidth;
+        bitCount = header.biBitCount;
+        stride = ((static_cast<size_t>(width) * bitCount + 31) / 32) * 4;
+        // A height of 0 means the driver does not know it yet, negative heights are top-down
+        topDown = header.biHeight <= 0;
+        expectedRows = header.biHeight != 0 ? std::abs(header.biHeight) : -1;
+        image.create(expectedRows > 0 ? expectedRows : std::max(1, width), width, CV_8UC3);
+        headerRead = true;
+        return true;
+    }
+
+    void appendRow(const BYTE *source) {
+        if (rows == image.rows) {
+            cv::Mat grown(image.rows * 2, width, CV_8UC3);
+            image.copyTo(grown.rowRange(0, image.rows));
+            image = grown;
+        }
+
+        cv::Vec3b *target = image.ptr<cv::Vec3b>(rows++);
+        for (int x = 0; x < width; x++) {
+            switch (bitCount) {
+            case 24:
+                target[x] = cv::Vec3b(source[3 * x], source[3 * x + 1], source[3 * x + 2]);
+                break;
+            case 32:
+                target[x] = cv::Vec3b(source[4 * x], source[4 * x + 1], source[4 * x + 2]);
+                break;
+            case 8:
+                target[x] = source[x] < palette.size() ? palette[source[x]] : cv::Vec3b::all(source[x]);
+                break;
+            default: {
+                int bit = (source[x / 8] >> (7 - x % 8)) & 1;
+                target[x] = bit < static_cast<int>(palette.size()) ? palette[bit] : cv::Vec3b::all(bit ? 255 : 0);
+                break;
+            }
+            }
+        }
+    }
+};
+
+// Minimal IWiaDataCallback implementation, also receives the data of banded transfers when given a reader
 class WiaDataCallback : public IWiaDataCallback {
 public:
+    WiaDataCallback() = default;
+    WiaDataCallback(ScannerInterface::ProgressCallback onProgress, const ScanCancelToken *cancel, DibBandReader *reader = nullptr)
+        : onProgress(std::move(onProgress)), cancel(cancel), reader(reader) {}
+
+    // Thrown by the progress or band callbacks, which must not unwind through the driver
+    std::exception_ptr error;
+
     ULONG STDMETHODCALLTYPE AddRef() override { return ++m_refCount; }
     ULONG STDMETHODCALLTYPE Release() override {
         if (--m_refCount == 0) {
@@ -332,26 +458,201 @@ public:
         LONG lReserved,
         LONG lResLength,
         BYTE *pbBuffer) override {
-        // For now, just ignore the callback. Implement if needed.
-        return S_OK;
+        try {
+            if (reader && lMessage == IT_MSG_DATA && pbBuffer && lLength > 0) {
+                reader->add(pbBuffer, lLength);
+            }
+            if (onProgress && (lMessage == IT_MSG_STATUS || lMessage == IT_MSG_DATA)) {
+                onProgress(lPercentComplete / 100.0);
+            }
+        } catch (...) {
+            error = std::current_exception();
+            return S_FALSE;
+        }
+        // S_FALSE makes the driver stop the transfer
+        return cancel && cancel->isCancelled() ? S_FALSE : S_OK;
     }
 
 private:
     ULONG m_refCount = 1;
+    ScannerInterface::ProgressCallback onProgress;
+    const ScanCancelToken *cancel = nullptr;
+    DibBandReader *reader = nullptr;
 };
 
 // scanImage implementation
 cv::Mat WiaScanner::scanImage() {
+    return scanImageStreamed({}, {}, ScanCancelToken());
+}
+
+cv::Mat WiaScanner::scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) {
+    bool banded = true;
+    IWiaDataTransfer *dataTransfer = openDataTransfer(banded);
+
+    cv::Mat image;
+    try {
+        image = banded ? transferBands(dataTransfer, onBand, onProgress, cancel)
+                       : transferPage(dataTransfer, onProgress, &cancel);
+    } catch (...) {
+        dataTransfer->Release();
+        throw;
+    }
+    dataTransfer->Release();
+
+    if (image.empty()) {
+        throw std::runtime_error("No document in the feeder");
+    }
+    if (!banded && onBand) {
+        onBand(image, 0, image.rows);
+    }
+    return image;
+}
+
+cv::Mat WiaScanner::transferBands(IWiaDataTransfer *dataTransfer, const BandCallback &onBand, const ProgressCallback &onProgress,
+                                  const ScanCancelToken &cancel) {
+    WIA_DATA_TRANSFER_INFO transferInfo = {};
+    transferInfo.ulSize = sizeof(transferInfo);
+    transferInfo.ulBufferSize = bandBufferSize;
+    transferInfo.bDoubleBuffer = TRUE;
+
+    DibBandReader reader(onBand);
+    WiaDataCallback *callback = new WiaDataCallback(onProgress, &cancel, &reader);
+
+    // The callback runs on this thread while idtGetBandedData waits for the driver
+    HRESULT hr = dataTransfer->idtGetBandedData(&transferInfo, callback);
+    std::exception_ptr error = callback->error;
+    callback->Release();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (cancel.isCancelled()) {
+        throw ScanCancelled();
+    }
+    if (hr == WIA_ERROR_PAPER_EMPTY) {
+        return cv::Mat();
+    }
+    if (FAILED(hr)) {
+        throw std::runtime_error("Failed to transfer image data. HRESULT: " + std::to_string(hr));
+    }
+    return reader.finish();
+}
+
+int WiaScanner::scanBatch(const PageCallback &onPage, int maxPages) {
+    if (!feederSelected) {
+        maxPages = 1;
+    }
+
+    // One transfer object for the whole batch, each idtGetData pulls the next sheet from the feeder
+    bool banded = false;
+    IWiaDataTransfer *dataTransfer = openDataTransfer(banded);
+
+    int pages = 0;
+    try {
+        while (maxPages == 0 || pages < maxPages) {
+            cv::Mat page = transferPage(dataTransfer);
+            if (page.empty()) {
+                break;
+            }
+            pages++;
+            if (!onPage(page)) {
+                break;
+            }
+        }
+    } catch (...) {
+        dataTransfer->Release();
+        throw;
+    }
+
+    dataTransfer->Release();
+    return pages;
+}
+
+bool WiaScanner::setSource(Source source) {
     if (!selectedDevice) {
         throw std::runtime_error("No scanner selected");
     }
 
-    // IWiaItem* scannerItem = nullptr;
-    // HRESULT hr = selectedDevice->EnumChildItems(&scannerItem);
+    // WIA 1.0 keeps the document handling properties on the root item
+    LONG capabilities = 0;
+    if (source == Source::Feeder &&
+        (!readDeviceProperty(WIA_DPS_DOCUMENT_HANDLING_CAPABILITIES, capabilities) || !(capabilities & FEED))) {
+        return false;
+    }
+
+    if (!writeDeviceProperty(WIA_DPS_DOCUMENT_HANDLING_SELECT, source == Source::Feeder ? FEEDER : FLATBED)) {
+        return source == Source::Flatbed;
+    }
+    if (source == Source::Feeder) {
+        // 0 asks the driver for every sheet in the feeder
+        writeDeviceProperty(WIA_DPS_PAGES, 0);
+    }
+
+    feederSelected = source == Source::Feeder;
+    return true;
+}
+
+ScannerInterface::Capabilities WiaScanner::queryCapabilities() {
+    if (!selectedDevice) {
+        throw std::runtime_error("No scanner selected");
+    }
+
+    Capabilities capabilities;
+
+    // Resolution and data type are item properties, the root item of the device does not have them
+    IWiaItem *scannerItem = openScanItem();
+    IWiaPropertyStorage *pStorage = nullptr;
+    HRESULT hr = scannerItem->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage);
+    scannerItem->Release();
+    if (FAILED(hr)) {
+        throw std::runtime_error("Failed to get property storage. HRESULT: " + std::to_string(hr));
+    }
+
+    // Resolutions are either a list or a range, see the WIA_PROP_LIST and WIA_PROP_RANGE attribute layouts
+    PROPSPEC resolutionSpec = {PRSPEC_PROPID, WIA_IPS_XRES};
+    ULONG accessFlags = 0;
+    PROPVARIANT attrVar = {};
+    hr = pStorage->GetPropertyAttributes(1, &resolutionSpec, &accessFlags, &attrVar);
+    if (SUCCEEDED(hr) && attrVar.vt == (VT_VECTOR | VT_I4)) {
+        if ((accessFlags & WIA_PROP_RANGE) && attrVar.cal.cElems > WIA_RANGE_MAX) {
+            capabilities.minDpi = attrVar.cal.pElems[WIA_RANGE_MIN];
+            capabilities.maxDpi = attrVar.cal.pElems[WIA_RANGE_MAX];
+        } else if (accessFlags & WIA_PROP_LIST) {
+            for (ULONG i = WIA_LIST_VALUES; i < attrVar.cal.cElems; i++) {
+                capabilities.resolutions.push_back(attrVar.cal.pElems[i]);
+            }
+        }
+    }
+    PropVariantClear(&attrVar);
+
+    PROPSPEC dataTypeSpec = {PRSPEC_PROPID, WIA_IPA_DATATYPE};
+    accessFlags = 0;
+    hr = pStorage->GetPropertyAttributes(1, &dataTypeSpec, &accessFlags, &attrVar);
+    if (SUCCEEDED(hr) && (accessFlags & WIA_PROP_LIST) && attrVar.vt == (VT_VECTOR | VT_I4)) {
+        // Same numbering as setColorOption
+        const LONG dataTypes[3] = {WIA_DATA_COLOR, WIA_DATA_GRAYSCALE, WIA_DATA_THRESHOLD};
+        for (int option = 1; option <= 3; option++) {
+            for (ULONG i = WIA_LIST_VALUES; i < attrVar.cal.cElems; i++) {
+                if (attrVar.cal.pElems[i] == dataTypes[option - 1]) {
+                    capabilities.colorOptions.push_back(option);
+                    break;
+                }
+            }
+        }
+    }
+    PropVariantClear(&attrVar);
+    pStorage->Release();
+
+    LONG handling = 0;
+    capabilities.hasFeeder = readDeviceProperty(WIA_DPS_DOCUMENT_HANDLING_CAPABILITIES, handling) && (handling & FEED);
 
-    // if (FAILED(hr) || !scannerItem) {
-    //     throw std::runtime_error("Failed to access scanner item");
-    // }
+    return capabilities;
+}
+
+IWiaItem *WiaScanner::openScanItem() {
+    if (!selectedDevice) {
+        throw std::runtime_error("No scanner selected");
+    }
 
     IEnumWiaItem *enumWiaItem = nullptr;
     HRESULT hr = selectedDevice->EnumChildItems(&enumWiaItem);
@@ -367,15 +668,31 @@ cv::Mat WiaScanner::scanImage() {
     if (FAILED(hr) || !scannerItem) {
         throw std::runtime_error("No scanner item found in the selected device.");
     }
+    return scannerItem;
+}
+
+IWiaDataTransfer *WiaScanner::openDataTransfer(bool &banded) {
+    IWiaItem *scannerItem = openScanItem();
+
+    try {
+        applyScanArea(scannerItem);
+        banded = selectTransferMedium(scannerItem, banded);
+    } catch (...) {
+        scannerItem->Release();
+        throw;
+    }
 
     IWiaDataTransfer *dataTransfer = nullptr;
-    hr = scannerItem->QueryInterface(IID_IWiaDataTransfer, (void **)&dataTransfer);
+    HRESULT hr = scannerItem->QueryInterface(IID_IWiaDataTransfer, (void **)&dataTransfer);
     scannerItem->Release();
 
     if (FAILED(hr)) {
         throw std::runtime_error("Failed to get IWiaDataTransfer interface");
     }
+    return dataTransfer;
+}
 
+cv::Mat WiaScanner::transferPage(IWiaDataTransfer *dataTransfer, const ProgressCallback &onProgress, const ScanCancelToken *cancel) {
     // Prepare STGMEDIUM for file-based transfer
     STGMEDIUM stgMedium = {};
     stgMedium.tymed = TYMED_FILE; // Transfer to a temporary file
@@ -384,14 +701,20 @@ cv::Mat WiaScanner::scanImage() {
     wcscat_s(tempFilePath, L"wia_scan.bmp");
     stgMedium.lpszFileName = tempFilePath;
 
-    // Create a minimal data callback
-    WiaDataCallback *callback = new WiaDataCallback();
+    // Reports progress and lets the transfer be cancelled
+    WiaDataCallback *callback = new WiaDataCallback(onProgress, cancel);
 
     // Perform data transfer
-    hr = dataTransfer->idtGetData(&stgMedium, callback);
-    dataTransfer->Release();
+    HRESULT hr = dataTransfer->idtGetData(&stgMedium, callback);
     callback->Release();
 
+    if (cancel && cancel->isCancelled()) {
+        DeleteFile(tempFilePath);
+        throw ScanCancelled();
+    }
+    if (hr == WIA_ERROR_PAPER_EMPTY) {
+        return cv::Mat();
+    }
     if (FAILED(hr)) {
         throw std::runtime_error("Failed to transfer image data");
     }
@@ -401,16 +724,224 @@ cv::Mat WiaScanner::scanImage() {
 
     // Load the scanned file into OpenCV
     cv::Mat image = cv::imread(narrowPath, cv::IMREAD_COLOR);
-    if (image.empty()) {
-        throw std::runtime_error("Failed to load scanned image");
-    }
 
     // Clean up temporary file
     DeleteFile(tempFilePath);
 
+    if (image.empty()) {
+        throw std::runtime_error("Failed to load scanned image");
+    }
     return image;
 }
 
+bool WiaScanner::selectTransferMedium(IWiaItem *item, bool banded) {
+    IWiaPropertyStorage *pStorage = nullptr;
+    HRESULT hr = item->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage);
+    if (FAILED(hr)) {
+        throw std::runtime_error("Failed to get property storage. HRESULT: " + std::to_string(hr));
+    }
+
+    // A previous transfer may have left the item on the other medium
+    PROPSPEC tymedSpec = {PRSPEC_PROPID, WIA_IPA_TYMED};
+    PROPVARIANT tymed = {};
+    tymed.vt = VT_I4;
+    tymed.lVal = banded ? TYMED_CALLBACK : TYMED_FILE;
+    bool selected = SUCCEEDED(pStorage->WriteMultiple(1, &tymedSpec, &tymed, 0));
+
+    if (banded && selected) {
+        GUID format = WiaImgFmt_MEMORYBMP;
+        PROPSPEC formatSpec = {PRSPEC_PROPID, WIA_IPA_FORMAT};
+        PROPVARIANT formatVar = {};
+        formatVar.vt = VT_CLSID;
+        formatVar.puuid = &format;
+        selected = SUCCEEDED(pStorage->WriteMultiple(1, &formatSpec, &formatVar, 0));
+
+        // The driver's minimum, or about a hundred colour rows of a letter size page at 300 dpi
+        PROPSPEC bufferSpec = {PRSPEC_PROPID, WIA_IPA_MIN_BUFFER_SIZE};
+        PROPVARIANT bufferVar = {};
+        bandBufferSize = defaultBandBufferSize;
+        if (SUCCEEDED(pStorage->ReadMultiple(1, &bufferSpec, &bufferVar)) && bufferVar.vt == VT_I4) {
+            bandBufferSize = (std::max)(static_cast<ULONG>(bufferVar.lVal), defaultBandBufferSize);
+        }
+        PropVariantClear(&bufferVar);
+
+        if (!selected) {
+            // Back to the file transfer every driver supports
+            tymed.lVal = TYMED_FILE;
+            pStorage->WriteMultiple(1, &tymedSpec, &tymed, 0);
+        }
+    }
+
+    pStorage->Release();
+    return banded && selected;
+}
+
+bool WiaScanner::readDeviceProperty(PROPID property, LONG &value) {
+    IWiaPropertyStorage *pStorage = nullptr;
+    if (FAILED(selectedDevice->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage))) {
+        return false;
+    }
+
+    PROPSPEC spec = {PRSPEC_PROPID, property};
+    PROPVARIANT propVar = {};
+    HRESULT hr = pStorage->ReadMultiple(1, &spec, &propVar);
+    pStorage->Release();
+
+    bool found = SUCCEEDED(hr) && propVar.vt == VT_I4;
+    if (found) {
+        value = propVar.lVal;
+    }
+    PropVariantClear(&propVar);
+    return found;
+}
+
+bool WiaScanner::writeDeviceProperty(PROPID property, LONG value) {
+    IWiaPropertyStorage *pStorage = nullptr;
+    if (FAILED(selectedDevice->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage))) {
+        return false;
+    }
+
+    PROPSPEC spec = {PRSPEC_PROPID, property};
+    PROPVARIANT propVar = {};
+    propVar.vt = VT_I4;
+    propVar.lVal = value;
+    HRESULT hr = pStorage->WriteMultiple(1, &spec, &propVar, 0);
+    pStorage->Release();
+    return SUCCEEDED(hr);
+}
+
+cv::Rect2d WiaScanner::setScanArea(const cv::Rect2d &areaInches) {
+    scanArea = cv::Rect2d();
+    if (areaInches.empty() || areaInches.x < 0 || areaInches.y < 0) {
+        return scanArea;
+    }
+
+    IWiaItem *scannerItem = openScanItem();
+    IWiaPropertyStorage *pStorage = nullptr;
+    HRESULT hr = scannerItem->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage);
+    scannerItem->Release();
+    if (FAILED(hr)) {
+        return scanArea;
+    }
+
+    // The area is written when scanning, it is only taken when the item lets its position and extent be
+    // set and it lies on the bed, whose size is the maximum extent at the current resolution
+    PROPSPEC resolutionSpecs[2] = {{PRSPEC_PROPID, WIA_IPS_XRES}, {PRSPEC_PROPID, WIA_IPS_YRES}};
+    PROPVARIANT resolution[2] = {};
+    hr = pStorage->ReadMultiple(2, resolutionSpecs, resolution);
+    bool accepted = SUCCEEDED(hr) && resolution[0].vt == VT_I4 && resolution[1].vt == VT_I4 &&
+                    resolution[0].lVal > 0 && resolution[1].lVal > 0;
+    LONG dpi[2] = {accepted ? resolution[0].lVal : 0, accepted ? resolution[1].lVal : 0};
+    PropVariantClear(&resolution[0]);
+    PropVariantClear(&resolution[1]);
+
+    const PROPID areaProperties[4] = {WIA_IPS_XPOS, WIA_IPS_YPOS, WIA_IPS_XEXTENT, WIA_IPS_YEXTENT};
+    LONG bed[2] = {0, 0};
+    for (int i = 0; i < 4 && accepted; i++) {
+        PROPSPEC spec = {PRSPEC_PROPID, areaProperties[i]};
+        ULONG accessFlags = 0;
+        PROPVARIANT attrVar = {};
+        hr = pStorage->GetPropertyAttributes(1, &spec, &accessFlags, &attrVar);
+        accepted = SUCCEEDED(hr) && (accessFlags & WIA_PROP_WRITE);
+        if (accepted && i >= 2) {
+            accepted = (accessFlags & WIA_PROP_RANGE) && attrVar.vt == (VT_VECTOR | VT_I4) && attrVar.cal.cElems > WIA_RANGE_MAX;
+            if (accepted) {
+                bed[i - 2] = attrVar.cal.pElems[WIA_RANGE_MAX];
+            }
+        }
+        PropVariantClear(&attrVar);
+    }
+    pStorage->Release();
+
+    // Half a pixel of slack for the rounding in applyScanArea
+    accepted = accepted && (areaInches.x + areaInches.width) * dpi[0] <= bed[0] + 0.5 &&
+               (areaInches.y + areaInches.height) * dpi[1] <= bed[1] + 0.5;
+    if (!accepted) {
+        return scanArea;
+    }
+    scanArea = areaInches;
+
+    // applyScanArea rounds to whole pixels at the item's resolution
+    auto toPixels = [](double inches, LONG resolution) { return static_cast<LONG>(inches * resolution + 0.5); };
+    return cv::Rect2d(static_cast<double>(toPixels(areaInches.x, dpi[0])) / dpi[0],
+                      static_cast<double>(toPixels(areaInches.y, dpi[1])) / dpi[1],
+                      static_cast<double>(toPixels(areaInches.width, dpi[0])) / dpi[0],
+                      static_cast<double>(toPixels(areaInches.height, dpi[1])) / dpi[1]);
+}
+
+void WiaScanner::clearScanArea() {
+    scanArea = cv::Rect2d();
+}
+
+void WiaScanner::applyScanArea(IWiaItem *item) {
+    IWiaPropertyStorage *pStorage = nullptr;
+    HRESULT hr = item->QueryInterface(IID_IWiaPropertyStorage, (void **)&pStorage);
+    if (FAILED(hr)) {
+        throw std::runtime_error("Failed to get property storage. HRESULT: " + std::to_string(hr));
+    }
+
+    // The position and extent are in pixels at the item's current resolution
+    PROPSPEC resolutionSpecs[2] = {{PRSPEC_PROPID, WIA_IPS_XRES}, {PRSPEC_PROPID, WIA_IPS_YRES}};
+    PROPVARIANT resolution[2] = {};
+    hr = pStorage->ReadMultiple(2, resolutionSpecs, resolution);
+    if (FAILED(hr) || resolution[0].vt != VT_I4 || resolution[1].vt != VT_I4) {
+        pStorage->Release();
+        throw std::runtime_error("Failed to read scan resolution. HRESULT: " + std::to_string(hr));
+    }
+    LONG xDpi = resolution[0].lVal;
+    LONG yDpi = resolution[1].lVal;
+
+    PROPSPEC areaSpecs[4] = {
+        {PRSPEC_PROPID, WIA_IPS_XPOS},
+        {PRSPEC_PROPID, WIA_IPS_YPOS},
+        {PRSPEC_PROPID, WIA_IPS_XEXTENT},
+        {PRSPEC_PROPID, WIA_IPS_YEXTENT}};
+    LONG values[4] = {0, 0, 0, 0};
+
+    for (int i = 2; i < 4; i++) {
+        // The full extent is the maximum of the extent's range at this resolution
+        ULONG accessFlags = 0;
+        PROPVARIANT attrVar = {};
+        hr = pStorage->GetPropertyAttributes(1, &areaSpecs[i], &accessFlags, &attrVar);
+        if (SUCCEEDED(hr) && (accessFlags & WIA_PROP_RANGE) && attrVar.vt == (VT_VECTOR | VT_I4) &&
+            attrVar.cal.cElems > WIA_RANGE_MAX) {
+            values[i] = attrVar.cal.pElems[WIA_RANGE_MAX];
+        }
+        PropVariantClear(&attrVar);
+    }
+
+    if (!scanArea.empty()) {
+        LONG left = static_cast<LONG>(scanArea.x * xDpi + 0.5);
+        LONG top = static_cast<LONG>(scanArea.y * yDpi + 0.5);
+        LONG width = static_cast<LONG>(scanArea.width * xDpi + 0.5);
+        LONG height = static_cast<LONG>(scanArea.height * yDpi + 0.5);
+
+        // Stay on the bed when the range is known
+        values[0] = left;
+        values[1] = top;
+        values[2] = values[2] > 0 ? (std::min)(width, values[2] - left) : width;
+        values[3] = values[3] > 0 ? (std::min)(height, values[3] - top) : height;
+    } else if (values[2] <= 0 || values[3] <= 0) {
+        // No range to restore the whole bed from, leave the item as it is
+        pStorage->Release();
+        return;
+    }
+
+    // Position first, the driver validates the extents against it
+    for (int i = 0; i < 4; i++) {
+        PROPVARIANT propVar = {};
+        propVar.vt = VT_I4;
+        propVar.lVal = values[i];
+        hr = pStorage->WriteMultiple(1, &areaSpecs[i], &propVar, 0);
+        if (FAILED(hr)) {
+            pStorage->Release();
+            throw std::runtime_error("Failed to set scan area. HRESULT: " + std::to_string(hr));
+        }
+    }
+
+    pStorage->Release();
+}
+
 void WiaScanner::printDeviceProperties(IWiaItem *device) {
     if (!device) {
         std::cerr << "printDeviceProperties: Device is null." << std::endl;
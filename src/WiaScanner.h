@@ -27,21 +27,55 @@ public:
     std::map<std::wstring, std::wstring> getAllScannerProperties() ;
     void setScannerProperty(const std::wstring& propertyName, const std::wstring& value) ;
     cv::Mat scanImage() override;
+    // Banded memory transfer, the rows are delivered as the driver sends them. Drivers that only
+    // transfer to files deliver the image as one band at the end.
+    cv::Mat scanImageStreamed(const BandCallback &onBand, const ProgressCallback &onProgress, const ScanCancelToken &cancel) override;
     void getDpiConstraints();
     void getColorOptions();
     void setDpi(int dpi) override;
     void setColorOption(int colorOption) override;
-
+    // Resolution and data type attributes of the scan item, and whether the device has a feeder
+    Capabilities queryCapabilities() override;
+    // Applied to the scan item as WIA_IPS_XPOS/YPOS/XEXTENT/YEXTENT at its resolution when scanning. Empty
+    // when the item has no writable position and extent ranges or the area is off the bed, set the
+    // resolution first.
+    cv::Rect2d setScanArea(const cv::Rect2d &areaInches) override;
+    void clearScanArea() override;
+    // Selects WIA_DPS_DOCUMENT_HANDLING_SELECT on the device, false when it has no feeder
+    bool setSource(Source source) override;
+    // Transfers pages from one IWiaDataTransfer until the driver reports WIA_ERROR_PAPER_EMPTY
+    int scanBatch(const PageCallback &onPage, int maxPages = 0) override;
 
 private:
     IWiaDevMgr* wiaDevMgr = nullptr;
     IWiaItem* selectedDevice = nullptr;
+    cv::Rect2d scanArea; // Inches, empty for the whole bed
+    bool feederSelected = false;
+    static constexpr ULONG defaultBandBufferSize = 1024 * 1024;
+    ULONG bandBufferSize = defaultBandBufferSize;
     
 
     IWiaItem* findDeviceByName(const std::wstring& name);
     HRESULT initialize();
     void cleanup();
 
+    void applyScanArea(IWiaItem *item);
+    // The first child item of the device, which holds the scan settings, released by the caller
+    IWiaItem *openScanItem();
+    // The first child item of the device with the scan area applied, released by the caller. banded asks
+    // for a memory transfer, it is false on return when the item only transfers to files.
+    IWiaDataTransfer *openDataTransfer(bool &banded);
+    // Sets WIA_IPA_TYMED and WIA_IPA_FORMAT on the item, returns whether the banded transfer was accepted
+    bool selectTransferMedium(IWiaItem *item, bool banded);
+    // idtGetBandedData with WiaImgFmt_MEMORYBMP, returns an empty Mat when the feeder is out of paper
+    cv::Mat transferBands(IWiaDataTransfer *dataTransfer, const BandCallback &onBand, const ProgressCallback &onProgress,
+                          const ScanCancelToken &cancel);
+    // Returns an empty Mat when the feeder is out of paper
+    static cv::Mat transferPage(IWiaDataTransfer *dataTransfer, const ProgressCallback &onProgress = {},
+                                const ScanCancelToken *cancel = nullptr);
+    bool readDeviceProperty(PROPID property, LONG &value);
+    bool writeDeviceProperty(PROPID property, LONG value);
+
     static void printDeviceProperties(IWiaItem *device);
 };
 
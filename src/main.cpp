@@ -1,8 +1,36 @@
+#include "ImageSaver.h"
 #include "MainWindow.h"
 #include "StartWindow.h"
 #include <QApplication>
+#include <QDebug>
+#include <cstring>
+
+// PichaScan --reorient <degrees> <photo.jpg>...
+// Turns saved photos by a multiple of 90 degrees clockwise without re-encoding them, see ImageSaver::reorient
+static int reorientPhotos(int argc, char *argv[]) {
+    bool ok = false;
+    int degrees = QString::fromLocal8Bit(argv[2]).toInt(&ok);
+    if (!ok || ImageSaver::exifOrientationFor(degrees) == 0) {
+        qWarning() << "Usage:" << argv[0] << "--reorient <90|180|270|-90> <photo.jpg>...";
+        return 2;
+    }
+
+    int failed = 0;
+    for (int i = 3; i < argc; i++) {
+        if (!ImageSaver::reorient(QString::fromLocal8Bit(argv[i]), degrees)) {
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
 
 int main(int argc, char *argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--reorient") == 0) {
+        // No windows, but QProcess needs an application object to run jpegtran
+        QCoreApplication app(argc, argv);
+        return reorientPhotos(argc, argv);
+    }
+
     // qputenv("QT_DEBUG_PLUGINS", QByteArray("1"));
     QApplication app(argc, argv);
 
@@ -0,0 +1,2 @@
+// Built with the AVX512_SKX instruction set enabled, see the SIMD section in CMakeLists.txt
+#include "../SaturationMask.simd.hpp"
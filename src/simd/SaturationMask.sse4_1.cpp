@@ -0,0 +1,2 @@
+// Built with the SSE4_1 instruction set enabled, see the SIMD section in CMakeLists.txt
+#include "../SaturationMask.simd.hpp"
@@ -0,0 +1,192 @@
+#include "QuadFitter.h"
+
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Outlines of photos as they come out of a scan: anti-aliased edges, a few cut corners, sensor
+// noise and JPEG artefacts, thresholded on saturation and traced the way ScanProcessor::findQuads does
+static std::vector<std::vector<cv::Point>> scanContours(int seed) {
+    cv::RNG rng(static_cast<uint64>(seed) + 1);
+    cv::Mat scan(1100, 850, CV_8UC3, cv::Scalar::all(250));
+
+    int photos = rng.uniform(1, 5);
+    for (int i = 0; i < photos; i++) {
+        cv::RotatedRect rect(cv::Point2f(rng.uniform(150.f, 700.f), rng.uniform(150.f, 950.f)),
+                             cv::Size2f(rng.uniform(80.f, 400.f), rng.uniform(80.f, 400.f)), rng.uniform(-30.f, 30.f));
+        cv::Point2f corners[4];
+        rect.points(corners);
+
+        std::vector<cv::Point2f> outline(corners, corners + 4);
+        if (rng.uniform(0.0, 1.0) < 0.3) {
+            // A cut corner leaves a pentagon
+            int corner = rng.uniform(0, 4);
+            cv::Point2f p = outline[corner];
+            cv::Point2f next = outline[(corner + 1) % 4];
+            cv::Point2f previous = outline[(corner + 3) % 4];
+            outline[corner] = p + (previous - p) * 0.15f;
+            outline.insert(outline.begin() + corner + 1, p + (next - p) * 0.15f);
+        }
+
+        // Sub-pixel vertices, 4 fractional bits
+        std::vector<std::vector<cv::Point>> polygon(1);
+        for (const auto &point : outline) {
+            polygon[0].emplace_back(cvRound(point.x * 16), cvRound(point.y * 16));
+        }
+        cv::Scalar color(rng.uniform(0, 200), rng.uniform(0, 200), rng.uniform(0, 200));
+        cv::fillPoly(scan, polygon, color, cv::LINE_AA, 4);
+    }
+
+    cv::Mat noise(scan.size(), CV_16SC3);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 3);
+    cv::Mat noisy;
+    scan.convertTo(noisy, CV_16SC3);
+    noisy += noise;
+    noisy.convertTo(scan, CV_8UC3);
+
+    std::vector<uchar> jpeg;
+    cv::imencode(".jpg", scan, jpeg, {cv::IMWRITE_JPEG_QUALITY, 85});
+    scan = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+
+    cv::Mat hsv;
+    cv::cvtColor(scan, hsv, cv::COLOR_BGR2HSV);
+    std::vector<cv::Mat> channels;
+    cv::split(hsv, channels);
+    cv::Mat mask;
+    cv::threshold(channels[1], mask, 5, 255, cv::THRESH_BINARY);
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    std::vector<std::vector<cv::Point>> photoContours;
+    for (const auto &contour : contours) {
+        if (cv::contourArea(contour) > 500) {
+            photoContours.push_back(contour);
+        }
+    }
+    return photoContours;
+}
+
+// Irregular outlines, some with blurred edges, for contours that are far from a quad
+static std::vector<std::vector<cv::Point>> blobContours(int seed) {
+    cv::RNG rng(static_cast<uint64>(seed) + 1000);
+    std::vector<std::vector<cv::Point>> blobs;
+
+    for (int i = 0; i < 5; i++) {
+        int vertices = rng.uniform(5, 14);
+        std::vector<double> angles(vertices);
+        for (auto &angle : angles) {
+            angle = rng.uniform(0.0, 2 * CV_PI);
+        }
+        std::sort(angles.begin(), angles.end());
+
+        std::vector<std::vector<cv::Point>> polygon(1);
+        for (double angle : angles) {
+            double radius = rng.uniform(40.0, 200.0);
+            polygon[0].emplace_back(cvRound(300 + radius * std::cos(angle)), cvRound(300 + radius * std::sin(angle)));
+        }
+
+        cv::Mat mask = cv::Mat::zeros(600, 600, CV_8UC1);
+        cv::fillPoly(mask, polygon, cv::Scalar(255));
+        if (rng.uniform(0.0, 1.0) < 0.5) {
+            cv::GaussianBlur(mask, mask, cv::Size(), rng.uniform(1.0, 8.0));
+            cv::threshold(mask, mask, 127, 255, cv::THRESH_BINARY);
+        }
+
+        std::vector<std::vector<cv::Point>> contours;
+        cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        for (const auto &contour : contours) {
+            if (contour.size() > 3) {
+                blobs.push_back(contour);
+            }
+        }
+    }
+    return blobs;
+}
+
+class TestQuadFitter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fitMatchesLinearSweep_data();
+    void fitMatchesLinearSweep();
+    void fitRejectsDegenerateContours();
+    void benchmarkFit_data();
+    void benchmarkFit();
+};
+
+void TestQuadFitter::fitMatchesLinearSweep_data() {
+    QTest::addColumn<int>("seed");
+    for (int seed = 0; seed < 100; seed++) {
+        QTest::newRow(qPrintable(QString("seed %1").arg(seed))) << seed;
+    }
+}
+
+void TestQuadFitter::fitMatchesLinearSweep() {
+    QFETCH(int, seed);
+
+    std::vector<std::vector<cv::Point>> contours = scanContours(seed);
+    std::vector<std::vector<cv::Point>> blobs = blobContours(seed);
+    contours.insert(contours.end(), blobs.begin(), blobs.end());
+    QVERIFY(!contours.empty());
+
+    for (const auto &contour : contours) {
+        QuadFit swept = QuadFitter::fitLinearSweep(contour);
+        QuadFit fitted = QuadFitter::fit(contour);
+
+        QVERIFY2(fitted.corners == swept.corners, "fit and fitLinearSweep chose different quads");
+        QCOMPARE(fitted.fitError, swept.fitError);
+        // 63 coarse steps down to epsilon 1 and at most 7 single steps below the last miss
+        QVERIFY(fitted.approximations <= 70);
+    }
+}
+
+void TestQuadFitter::fitRejectsDegenerateContours() {
+    // A straight line never leaves 4 vertices
+    std::vector<cv::Point> line = {{0, 0}, {50, 0}, {100, 0}, {50, 0}};
+    QVERIFY(QuadFitter::fit(line).corners.empty());
+    QVERIFY(QuadFitter::fitLinearSweep(line).corners.empty());
+}
+
+void TestQuadFitter::benchmarkFit_data() {
+    QTest::addColumn<QString>("method");
+    QTest::newRow("fit") << "fit";
+    QTest::newRow("fitLinearSweep") << "fitLinearSweep";
+    // The alternative to the coarse sweep: far fewer points per approximation, but cut corners stay in
+    QTest::newRow("fit on the convex hull") << "convexHull";
+}
+
+void TestQuadFitter::benchmarkFit() {
+    QFETCH(QString, method);
+
+    // Photo outlines only, the blobs are not what a scan is made of
+    std::vector<std::vector<cv::Point>> contours;
+    for (int seed = 0; seed < 20; seed++) {
+        std::vector<std::vector<cv::Point>> photos = scanContours(seed);
+        contours.insert(contours.end(), photos.begin(), photos.end());
+    }
+
+    int fitted = 0;
+    QBENCHMARK {
+        for (const auto &contour : contours) {
+            QuadFit quad;
+            if (method == "fitLinearSweep") {
+                quad = QuadFitter::fitLinearSweep(contour);
+            } else if (method == "convexHull") {
+                std::vector<cv::Point> hull;
+                cv::convexHull(contour, hull);
+                quad = QuadFitter::fit(hull);
+            } else {
+                quad = QuadFitter::fit(contour);
+            }
+            fitted += quad.corners.empty() ? 0 : 1;
+        }
+    }
+    QVERIFY(fitted > 0);
+}
+
+QTEST_APPLESS_MAIN(TestQuadFitter)
+#include "tst_quadfitter.moc"
@@ -0,0 +1,70 @@
+#include "ScanProcessor.h"
+
+#include <QtTest>
+#include <opencv2/opencv.hpp>
+
+// cropRotatedRect before it warped only the destination rectangle: rotate the whole image, then crop
+static cv::Mat fullWarpCrop(const cv::Mat &image, const cv::RotatedRect &rotRect) {
+    cv::Mat rotationMatrix = cv::getRotationMatrix2D(rotRect.center, rotRect.angle, 1.0);
+
+    cv::Mat rotatedImage;
+    cv::warpAffine(image, rotatedImage, rotationMatrix, image.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+    cv::Size rectSize = rotRect.size;
+    if (rotRect.angle < -45.0) {
+        std::swap(rectSize.width, rectSize.height);
+    }
+    cv::Rect uprightBoundingBox(cv::Point(rotRect.center.x - rectSize.width / 2,
+                                          rotRect.center.y - rectSize.height / 2),
+                                rectSize);
+
+    return rotatedImage(uprightBoundingBox & cv::Rect(0, 0, rotatedImage.cols, rotatedImage.rows)).clone();
+}
+
+class TestScanProcessor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cropRotatedRectMatchesFullWarp_data();
+    void cropRotatedRectMatchesFullWarp();
+};
+
+void TestScanProcessor::cropRotatedRectMatchesFullWarp_data() {
+    QTest::addColumn<int>("seed");
+    for (int seed = 0; seed < 50; seed++) {
+        QTest::newRow(qPrintable(QString("seed %1").arg(seed))) << seed;
+    }
+}
+
+void TestScanProcessor::cropRotatedRectMatchesFullWarp() {
+    QFETCH(int, seed);
+    cv::RNG rng(static_cast<uint64>(seed) + 1);
+
+    // Pixel noise is the worst case for interpolation differences, a blurred copy looks more like a photo
+    cv::Mat image(rng.uniform(200, 900), rng.uniform(200, 900), CV_8UC3);
+    rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+    if (seed % 2) {
+        cv::GaussianBlur(image, image, cv::Size(), rng.uniform(0.5, 3.0));
+    }
+
+    for (int i = 0; i < 6; i++) {
+        // Centers up to 50 pixels off the image, so some boxes are clipped or miss it entirely
+        cv::RotatedRect rect(cv::Point2f(rng.uniform(-50.f, image.cols + 50.f), rng.uniform(-50.f, image.rows + 50.f)),
+                             cv::Size2f(rng.uniform(10.f, 400.f), rng.uniform(10.f, 400.f)), rng.uniform(-90.f, 90.f));
+
+        cv::Mat expected = fullWarpCrop(image, rect);
+        cv::Mat cropped = ScanProcessor::cropRotatedRect(image, rect);
+
+        QCOMPARE(cropped.size(), expected.size());
+        if (expected.empty()) {
+            continue;
+        }
+        QCOMPARE(cropped.type(), expected.type());
+        // Only the fixed point rounding of the sample positions differs, by at most one grey level
+        QVERIFY(cv::norm(cropped, expected, cv::NORM_INF) <= 1.0);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestScanProcessor)
+#include "tst_scanprocessor.moc"